@@ -41,6 +41,31 @@ input_getc (void)
   return key;
 }
 
+/* Retrieves N keys from the input buffer into KEYS, waiting
+   for keys to be pressed as necessary.  Keys are moved a chunk
+   at a time, and the waiting thread is woken only once a chunk's
+   worth of keys has arrived. */
+void
+input_read (uint8_t *keys, size_t n) 
+{
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  while (n > 0) 
+    {
+      /* Reassess the serial receive interrupt after each chunk.
+         A chunk no larger than the watermark only has to wait
+         for keys if the buffer was not full, in which case
+         receive interrupts are already enabled. */
+      size_t chunk = n < INTQ_WATERMARK ? n : INTQ_WATERMARK;
+      intq_read (&buffer, keys, chunk);
+      serial_notify ();
+      keys += chunk;
+      n -= chunk;
+    }
+  intr_set_level (old_level);
+}
+
 /* Returns true if the input buffer is full,
    false otherwise.
    Interrupts must be off. */
@@ -1,9 +1,12 @@
 #include "devices/intq.h"
 #include <debug.h>
+#include <string.h>
 #include "threads/thread.h"
 
 static int next (int pos);
-static void wait (struct intq *q, struct thread **waiter);
+static size_t used (const struct intq *q);
+static size_t space (const struct intq *q);
+static void wait (struct intq *q, struct thread **waiter, size_t want);
 static void signal (struct intq *q, struct thread **waiter);
 
 /* Initializes interrupt queue Q. */
@@ -12,6 +15,7 @@ intq_init (struct intq *q)
 {
   lock_init (&q->lock);
   q->not_full = q->not_empty = NULL;
+  q->full_want = q->empty_want = 0;
   q->head = q->tail = 0;
 }
 
@@ -44,7 +48,7 @@ intq_getc (struct intq *q)
     {
       ASSERT (!intr_context ());
       lock_acquire (&q->lock);
-      wait (q, &q->not_empty);
+      wait (q, &q->not_empty, 1);
       lock_release (&q->lock);
     }
   
@@ -65,7 +69,7 @@ intq_putc (struct intq *q, uint8_t byte)
     {
       ASSERT (!intr_context ());
       lock_acquire (&q->lock);
-      wait (q, &q->not_full);
+      wait (q, &q->not_full, 1);
       lock_release (&q->lock);
     }
 
@@ -73,7 +77,75 @@ intq_putc (struct intq *q, uint8_t byte)
   q->head = next (q->head);
   signal (q, &q->not_empty);
 }
-
+
+/* Removes N bytes from Q into BUF, copying as much as is
+   available at a time.  Whenever Q runs dry, sleeps until
+   INTQ_WATERMARK bytes, or all the bytes still needed, have been
+   added.  When called from an interrupt handler, Q must hold at
+   least N bytes. */
+void
+intq_read (struct intq *q, uint8_t *buf, size_t n) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  while (n > 0) 
+    {
+      size_t cnt = used (q);
+      if (cnt == 0) 
+        {
+          ASSERT (!intr_context ());
+          lock_acquire (&q->lock);
+          wait (q, &q->not_empty, n < INTQ_WATERMARK ? n : INTQ_WATERMARK);
+          lock_release (&q->lock);
+          continue;
+        }
+
+      /* Copy up to the end of the buffer, then wrap around on
+         the next pass. */
+      if (cnt > n)
+        cnt = n;
+      if (cnt > (size_t) (INTQ_BUFSIZE - q->tail))
+        cnt = INTQ_BUFSIZE - q->tail;
+      memcpy (buf, q->buf + q->tail, cnt);
+      q->tail = (q->tail + cnt) % INTQ_BUFSIZE;
+      buf += cnt;
+      n -= cnt;
+      signal (q, &q->not_full);
+    }
+}
+
+/* Adds the N bytes in BUF to the end of Q, copying as much as
+   fits at a time.  Whenever Q fills up, sleeps until
+   INTQ_WATERMARK bytes, or all the bytes still to be written,
+   have been freed.  When called from an interrupt handler, Q
+   must have room for N bytes. */
+void
+intq_write (struct intq *q, const uint8_t *buf, size_t n) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  while (n > 0) 
+    {
+      size_t cnt = space (q);
+      if (cnt == 0) 
+        {
+          ASSERT (!intr_context ());
+          lock_acquire (&q->lock);
+          wait (q, &q->not_full, n < INTQ_WATERMARK ? n : INTQ_WATERMARK);
+          lock_release (&q->lock);
+          continue;
+        }
+
+      if (cnt > n)
+        cnt = n;
+      if (cnt > (size_t) (INTQ_BUFSIZE - q->head))
+        cnt = INTQ_BUFSIZE - q->head;
+      memcpy (q->buf + q->head, buf, cnt);
+      q->head = (q->head + cnt) % INTQ_BUFSIZE;
+      buf += cnt;
+      n -= cnt;
+      signal (q, &q->not_empty);
+    }
+}
+
 /* Returns the position after POS within an intq. */
 static int
 next (int pos) 
@@ -81,32 +153,62 @@ next (int pos)
   return (pos + 1) % INTQ_BUFSIZE;
 }
 
+/* Returns the number of bytes in Q. */
+static size_t
+used (const struct intq *q) 
+{
+  return (q->head - q->tail + INTQ_BUFSIZE) % INTQ_BUFSIZE;
+}
+
+/* Returns the number of bytes that can be added to Q. */
+static size_t
+space (const struct intq *q) 
+{
+  return INTQ_BUFSIZE - 1 - used (q);
+}
+
 /* WAITER must be the address of Q's not_empty or not_full
-   member.  Waits until the given condition is true. */
+   member.  Waits until WANT bytes, or free bytes respectively,
+   are available.  WANT may not exceed INTQ_WATERMARK, so a full
+   or empty queue always satisfies it. */
 static void
-wait (struct intq *q UNUSED, struct thread **waiter) 
+wait (struct intq *q, struct thread **waiter, size_t want) 
 {
   ASSERT (!intr_context ());
   ASSERT (intr_get_level () == INTR_OFF);
   ASSERT ((waiter == &q->not_empty && intq_empty (q))
           || (waiter == &q->not_full && intq_full (q)));
+  ASSERT (want > 0 && want <= INTQ_WATERMARK);
 
   *waiter = thread_current ();
+  if (waiter == &q->not_empty)
+    q->empty_want = want;
+  else
+    q->full_want = want;
   thread_block ();
 }
 
 /* WAITER must be the address of Q's not_empty or not_full
    member, and the associated condition must be true.  If a
-   thread is waiting for the condition, wakes it up and resets
+   thread is waiting for the condition and enough bytes, or free
+   bytes, have accumulated to satisfy it, wakes it up and resets
    the waiting thread. */
 static void
-signal (struct intq *q UNUSED, struct thread **waiter) 
+signal (struct intq *q, struct thread **waiter) 
 {
+  bool ready;
+
   ASSERT (intr_get_level () == INTR_OFF);
   ASSERT ((waiter == &q->not_empty && !intq_empty (q))
           || (waiter == &q->not_full && !intq_full (q)));
 
-  if (*waiter != NULL) 
+  if (*waiter == NULL)
+    return;
+  if (waiter == &q->not_empty)
+    ready = used (q) >= q->empty_want;
+  else
+    ready = space (q) >= q->full_want;
+  if (ready) 
     {
       thread_unblock (*waiter);
       *waiter = NULL;
@@ -1,6 +1,7 @@
 #ifndef DEVICES_INTQ_H
 #define DEVICES_INTQ_H
 
+#include <stddef.h>
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 
@@ -20,6 +21,11 @@
 /* Queue buffer size, in bytes. */
 #define INTQ_BUFSIZE 64
 
+/* A thread blocked in a bulk transfer is woken only once this
+   many bytes (or free bytes) are available, or fewer if that
+   completes its transfer, instead of on every byte. */
+#define INTQ_WATERMARK (INTQ_BUFSIZE / 2)
+
 /* A circular queue of bytes. */
 struct intq
   {
@@ -27,6 +33,8 @@ struct intq
     struct lock lock;           /* Only one thread may wait at once. */
     struct thread *not_full;    /* Thread waiting for not-full condition. */
     struct thread *not_empty;   /* Thread waiting for not-empty condition. */
+    size_t full_want;           /* Free bytes not_full is waiting for. */
+    size_t empty_want;          /* Bytes not_empty is waiting for. */
 
     /* Queue. */
     uint8_t buf[INTQ_BUFSIZE];  /* Buffer. */
@@ -39,5 +47,7 @@ bool intq_empty (const struct intq *);
 bool intq_full (const struct intq *);
 uint8_t intq_getc (struct intq *);
 void intq_putc (struct intq *, uint8_t);
+void intq_read (struct intq *, uint8_t *, size_t);
+void intq_write (struct intq *, const uint8_t *, size_t);
 
 #endif /* devices/intq.h */
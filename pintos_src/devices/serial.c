@@ -98,33 +98,55 @@ serial_init_queue (void)
 void
 serial_putc (uint8_t byte) 
 {
+  serial_write (&byte, 1);
+}
+
+/* Sends the N bytes in BUFFER to the serial port. */
+void
+serial_write (const void *buffer, size_t n) 
+{
+  const uint8_t *p = buffer;
   enum intr_level old_level = intr_disable ();
 
   if (mode != QUEUE)
     {
       /* If we're not set up for interrupt-driven I/O yet,
-         use dumb polling to transmit a byte. */
+         use dumb polling to transmit the bytes. */
       if (mode == UNINIT)
         init_poll ();
-      putc_poll (byte); 
+      while (n-- > 0)
+        putc_poll (*p++); 
     }
-  else 
+  else if (old_level == INTR_OFF) 
     {
-      /* Otherwise, queue a byte and update the interrupt enable
-         register. */
-      if (old_level == INTR_OFF && intq_full (&txq)) 
+      /* Interrupts are off, so we can't wait for the transmit
+         queue to drain without reenabling them.  That's
+         impolite, so whenever the queue is full we send a
+         character via polling instead. */
+      while (n-- > 0) 
         {
-          /* Interrupts are off and the transmit queue is full.
-             If we wanted to wait for the queue to empty,
-             we'd have to reenable interrupts.
-             That's impolite, so we'll send a character via
-             polling instead. */
-          putc_poll (intq_getc (&txq)); 
+          if (intq_full (&txq))
+            putc_poll (intq_getc (&txq)); 
+          intq_putc (&txq, *p++);
         }
-
-      intq_putc (&txq, byte); 
       write_ier ();
     }
+  else
+    {
+      /* Otherwise, queue the bytes a chunk at a time and update
+         the interrupt enable register after each chunk.  A chunk
+         no larger than the watermark only has to wait for room if
+         the queue was already nonempty, in which case the
+         transmit interrupt is already enabled to drain it. */
+      while (n > 0) 
+        {
+          size_t chunk = n < INTQ_WATERMARK ? n : INTQ_WATERMARK;
+          intq_write (&txq, p, chunk);
+          write_ier ();
+          p += chunk;
+          n -= chunk;
+        }
+    }
   
   intr_set_level (old_level);
 }
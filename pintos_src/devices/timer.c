@@ -21,11 +21,48 @@
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* If false (default), take a timer interrupt on every tick.
+   If true, stop the periodic tick while the CPU is idle.
+   Controlled by kernel command-line option "-tickless". */
+bool timer_tickless;
+
+/* PIT cycles per timer tick, and the most ticks that a single
+   one-shot can cover given the PIT's 16-bit counter. */
+#define TICK_CYCLES ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+#define ONESHOT_MAX_TICKS (65535 / TICK_CYCLES)
+
+/* Tickless idle state. */
+static int64_t oneshot_ticks;   /* Ticks covered by the armed one-shot, or 0. */
+static int64_t skipped_ticks;   /* Idle ticks not yet accounted for. */
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* Sleeping threads are kept in a hierarchical timing wheel of
+   WHEEL_LEVELS levels with WHEEL_SIZE slots each.  A thread that
+   wakes up less than WHEEL_SIZE ticks from now sits in level 0,
+   in the slot for its exact wakeup tick; a thread that wakes up
+   later sits in a coarser level, each slot of level L covering
+   WHEEL_SIZE**L ticks.  Whenever the level L - 1 index wraps
+   around, the current level L slot is "cascaded", that is, its
+   threads are redistributed into finer levels.  Inserting and
+   cancelling a sleeper are O(1), and each tick only touches the
+   sleepers that expire in it plus those cascaded down. */
+#define WHEEL_BITS 6                            /* Bits per level. */
+#define WHEEL_SIZE (1 << WHEEL_BITS)            /* Slots per level. */
+#define WHEEL_MASK (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS 4                          /* Number of levels. */
+#define WHEEL_SPAN ((int64_t) 1 << (WHEEL_BITS * WHEEL_LEVELS))
+
+static struct list wheel[WHEEL_LEVELS][WHEEL_SIZE];
+
 static intr_handler_func timer_interrupt;
+static void timer_advance (bool idle);
+static void wheel_insert (struct thread *);
+static int wheel_cascade (int level);
+static void wheel_expire (void);
+static int64_t wheel_idle_ticks (int64_t max);
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
@@ -36,6 +73,12 @@ static void real_time_delay (int64_t num, int32_t denom);
 void
 timer_init (void) 
 {
+  int level, slot;
+
+  for (level = 0; level < WHEEL_LEVELS; level++)
+    for (slot = 0; slot < WHEEL_SIZE; slot++)
+      list_init (&wheel[level][slot]);
+
   pit_configure_channel (0, 2, TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
@@ -93,20 +136,51 @@ timer_sleep (int64_t ticks)
   int64_t init = timer_ticks ();
 
   ASSERT (intr_get_level () == INTR_ON);
+  if (ticks <= 0)
+    return;
 
   //save the present level; returns the level before disabling
   enum intr_level prev_level = intr_disable();
   
   /* sleep the thread for `ticks` seconds,until the tick becomes [init + ticks]*/
-  int64_t sleep_endtick = init + ticks;
-
-  /*Add cuurent thread to wait_elem_list whose sleep time is sleep_endticks*/
-  thread_sleep_till(sleep_endtick);
+  if (timer_add (thread_current (), init + ticks))
+    thread_block ();
 
   //set to previous level i.e, enabling interrupt handler
   intr_set_level (prev_level);
 }
 
+/* Arranges for blocked thread T to be unblocked by the timer
+   interrupt at tick DEADLINE.  Returns false, without arming
+   anything, if DEADLINE has already passed.  Interrupts must be
+   off, and T must not already be waiting on the timer. */
+bool
+timer_add (struct thread *t, int64_t deadline)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->sleep_endtick == 0);
+
+  if (deadline <= ticks)
+    return false;
+  t->sleep_endtick = deadline;
+  wheel_insert (t);
+  return true;
+}
+
+/* Disarms T's pending timer_add(), if any.  Interrupts must be
+   off. */
+void
+timer_cancel (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (t->sleep_endtick != 0)
+    {
+      list_remove (&t->wait_elem);
+      t->sleep_endtick = 0;
+    }
+}
+
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
    turned on. */
 void
@@ -177,15 +251,86 @@ timer_print_stats (void)
   printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
 }
 
+/* Called by the idle thread, with interrupts off, just before
+   it halts the CPU.  In tickless mode, replaces the periodic
+   tick by a single interrupt at the next tick that has work to
+   do, that is, the next sleeper deadline or wheel cascade. */
+void
+timer_idle_enter (void)
+{
+  int64_t skip;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!timer_tickless || oneshot_ticks != 0)
+    return;
+
+  skip = wheel_idle_ticks (ONESHOT_MAX_TICKS);
+  if (skip < 2)
+    return;
+  ASSERT (skip * TICK_CYCLES <= UINT16_MAX);
+  oneshot_ticks = skip;
+  pit_configure_oneshot (0, skip * TICK_CYCLES);
+}
+
+/* Called by the scheduler, with interrupts off, whenever the
+   idle thread stops running.  If a one-shot is still armed,
+   restores the periodic tick.  The idle ticks that elapsed in
+   the meantime are accounted for by the next timer interrupt;
+   any partial tick is dropped. */
+void
+timer_idle_exit (void)
+{
+  uint16_t count;
+  bool expired;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (oneshot_ticks == 0)
+    return;
+
+  count = pit_read_channel (0, &expired);
+  if (expired)
+    {
+      /* The one-shot's own interrupt is pending and will
+         account for its last tick. */
+      skipped_ticks = oneshot_ticks - 1;
+    }
+  else
+    skipped_ticks = (oneshot_ticks * TICK_CYCLES - count) / TICK_CYCLES;
+  oneshot_ticks = 0;
+  pit_configure_channel (0, 2, TIMER_FREQ);
+}
+
 /* Timer interrupt handler. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED)
+{
+  if (oneshot_ticks != 0)
+    {
+      /* The one-shot armed by timer_idle_enter() expired.  All
+         of its ticks but this one passed without an interrupt. */
+      skipped_ticks = oneshot_ticks - 1;
+      oneshot_ticks = 0;
+      pit_configure_channel (0, 2, TIMER_FREQ);
+    }
+
+  for (; skipped_ticks > 0; skipped_ticks--)
+    timer_advance (true);
+  timer_advance (false);
+}
+
+/* Accounts for one timer tick.  IDLE is true for a tick that the
+   CPU spent halted without taking an interrupt for it. */
+static void
+timer_advance (bool idle)
 {
   ticks++;
 
   if (thread_mlfqs)
   {
-    thread_current ()->recent_cpu = ADD_INT (thread_current ()->recent_cpu, 1);
+    if (!idle)
+      thread_current ()->recent_cpu = ADD_INT (thread_current ()->recent_cpu, 1);
     if (ticks % TIMER_FREQ == 0) /* do this every second */
       {
         thread_update_load_avg ();
@@ -194,7 +339,98 @@ timer_interrupt (struct intr_frame *args UNUSED)
     if (ticks % 4 == 3)
       thread_update_priority_for_all ();
   }  
-  thread_tick (ticks); 
+  wheel_expire ();
+  if (idle)
+    thread_tick_idle ();
+  else
+    thread_tick (); 
+}
+
+/* Puts sleeping thread T into the wheel slot that covers its
+   sleep_endtick, relative to the current tick. */
+static void
+wheel_insert (struct thread *t)
+{
+  int64_t expires = t->sleep_endtick;
+  int64_t delta = expires - ticks;
+  int level;
+
+  ASSERT (delta >= 0);
+
+  /* Deadlines beyond the wheel's span are parked in the last
+     slot that it can represent and re-filed when cascaded. */
+  if (delta >= WHEEL_SPAN)
+    expires = ticks + WHEEL_SPAN - 1;
+
+  for (level = 0; level < WHEEL_LEVELS - 1; level++)
+    if (delta < (int64_t) 1 << (WHEEL_BITS * (level + 1)))
+      break;
+  list_push_back (&wheel[level][(expires >> (WHEEL_BITS * level))
+                                & WHEEL_MASK],
+                  &t->wait_elem);
+}
+
+/* Re-files every thread in the current slot of LEVEL into finer
+   levels.  Returns the index of the slot that was cascaded. */
+static int
+wheel_cascade (int level)
+{
+  int idx = (ticks >> (WHEEL_BITS * level)) & WHEEL_MASK;
+  struct list *slot = &wheel[level][idx];
+  struct list pending;
+
+  list_init (&pending);
+  while (!list_empty (slot))
+    list_push_back (&pending, list_pop_front (slot));
+  while (!list_empty (&pending))
+    wheel_insert (list_entry (list_pop_front (&pending),
+                              struct thread, wait_elem));
+  return idx;
+}
+
+/* Cascades the coarser levels as needed and wakes up every
+   thread whose sleep_endtick is the current tick.  Requests a
+   yield on return from the interrupt if one of them should
+   preempt the running thread. */
+static void
+wheel_expire (void)
+{
+  struct list *slot;
+  int level;
+  bool woken = false;
+
+  if ((ticks & WHEEL_MASK) == 0)
+    for (level = 1; level < WHEEL_LEVELS; level++)
+      if (wheel_cascade (level) != 0)
+        break;
+
+  slot = &wheel[0][ticks & WHEEL_MASK];
+  while (!list_empty (slot))
+    {
+      struct thread *t = list_entry (list_pop_front (slot),
+                                     struct thread, wait_elem);
+      ASSERT (t->sleep_endtick == ticks);
+      t->sleep_endtick = 0;
+      thread_unblock (t);
+      woken = true;
+    }
+
+  if (woken)
+    thread_preempt ();
+}
+
+/* Returns the number of ticks from now until the next tick at
+   which the wheel has work to do, or MAX if there is none sooner.
+   A tick that may cascade a coarser level counts as work. */
+static int64_t
+wheel_idle_ticks (int64_t max)
+{
+  int64_t t;
+
+  for (t = ticks + 1; t < ticks + max; t++)
+    if ((t & WHEEL_MASK) == 0 || !list_empty (&wheel[0][t & WHEEL_MASK]))
+      break;
+  return t - ticks;
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -2,8 +2,11 @@
 #define DEVICES_TIMER_H
 
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
+struct thread;
+
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
@@ -19,6 +22,15 @@ void timer_msleep (int64_t milliseconds);
 void timer_usleep (int64_t microseconds);
 void timer_nsleep (int64_t nanoseconds);
 
+/* Timed wakeups of blocked threads. */
+bool timer_add (struct thread *, int64_t deadline);
+void timer_cancel (struct thread *);
+
+/* Tickless idle. */
+extern bool timer_tickless;
+void timer_idle_enter (void);
+void timer_idle_exit (void);
+
 /* Busy waits. */
 void timer_mdelay (int64_t milliseconds);
 void timer_udelay (int64_t microseconds);
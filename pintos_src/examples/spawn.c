@@ -0,0 +1,43 @@
+/* spawn.c
+
+   Spawns N children that exit at once, then waits for each of
+   them.  A child that has exited lingers until its parent waits
+   for it, so the kernel holds up to N threads while it looks up
+   tids in exec and wait.  Compare the timer ticks reported at
+   shutdown for, e.g., "pintos -- run 'spawn 2000'". */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+
+#define MAX_CHILDREN 4096
+
+int
+main (int argc, char *argv[])
+{
+  static pid_t children[MAX_CHILDREN];
+  int n, i, failed = 0;
+
+  if (argc == 2 && !strcmp (argv[1], "-c"))
+    return 0;
+  if (argc != 2 || (n = atoi (argv[1])) <= 0 || n > MAX_CHILDREN) 
+    {
+      printf ("usage: spawn <count>, count <= %d\n", MAX_CHILDREN);
+      exit (1);
+    }
+
+  for (i = 0; i < n; i++)
+    {
+      children[i] = exec ("spawn -c");
+      if (children[i] == PID_ERROR)
+        break;
+    }
+  n = i;
+  for (i = 0; i < n; i++)
+    if (wait (children[i]) != 0)
+      failed++;
+
+  printf ("spawn: reaped %d children, %d failed\n", n, failed);
+  return failed != 0;
+}
@@ -6,6 +6,8 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -28,11 +30,20 @@ bytes_to_sectors (off_t size)
   return DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE);
 }
 
-/* In-memory inode. */
+/* In-memory inode.
+
+   `rw' protects the other members except `elem' and `sector',
+   as well as the inode's data on disk.  Reads of the data hold
+   it for reading, so they overlap.  Writes of the data hold it
+   for writing, because a write to part of a sector reads the
+   rest of the sector back first, and two such writes at once
+   would lose one of them.  Changes to the open, deny-write and
+   removed state also hold it for writing. */
 struct inode 
   {
     struct list_elem elem;              /* Element in inode list. */
     block_sector_t sector;              /* Sector number of disk location. */
+    struct rwlock rw;                   /* Protects the inode's metadata. */
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
@@ -54,14 +65,37 @@ byte_to_sector (const struct inode *inode, off_t pos)
 }
 
 /* List of open inodes, so that opening a single inode twice
-   returns the same `struct inode'. */
+   returns the same `struct inode'.  Searching the list holds
+   open_inodes_lock for reading; adding or removing an inode
+   holds it for writing.  open_inodes_lock is always acquired
+   before an inode's `rw'. */
 static struct list open_inodes;
+static struct rwlock open_inodes_lock;
+
+/* Cache of `struct inode's.  An inode's `rw' is initialized
+   when its slab is created and is released before the inode is
+   freed, so it stays initialized from one use to the next. */
+static struct kmem_cache inode_cache;
+
+static struct inode *find_open_inode (block_sector_t);
+static kmem_ctor_func inode_ctor;
 
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
   list_init (&open_inodes);
+  rwlock_init (&open_inodes_lock);
+  kmem_cache_init (&inode_cache, "inode", sizeof (struct inode), inode_ctor);
+}
+
+/* Constructs the inode at INODE_ for inode_cache. */
+static void
+inode_ctor (void *inode_)
+{
+  struct inode *inode = inode_;
+
+  rwlock_init (&inode->rw);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -111,26 +145,32 @@ inode_create (block_sector_t sector, off_t length)
 struct inode *
 inode_open (block_sector_t sector)
 {
-  struct list_elem *e;
-  struct inode *inode;
+  struct inode *inode, *open;
 
   /* Check whether this inode is already open. */
-  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-       e = list_next (e)) 
-    {
-      inode = list_entry (e, struct inode, elem);
-      if (inode->sector == sector) 
-        {
-          inode_reopen (inode);
-          return inode; 
-        }
-    }
+  rwlock_acquire_read (&open_inodes_lock);
+  inode = inode_reopen (find_open_inode (sector));
+  rwlock_release_read (&open_inodes_lock);
+  if (inode != NULL)
+    return inode;
 
   /* Allocate memory. */
-  inode = malloc (sizeof *inode);
+  inode = kmem_cache_alloc (&inode_cache);
   if (inode == NULL)
     return NULL;
 
+  /* Check again, in case another thread opened the inode while
+     we did not hold the lock. */
+  rwlock_acquire_write (&open_inodes_lock);
+  open = find_open_inode (sector);
+  if (open != NULL)
+    {
+      inode_reopen (open);
+      rwlock_release_write (&open_inodes_lock);
+      kmem_cache_free (&inode_cache, inode);
+      return open;
+    }
+
   /* Initialize. */
   list_push_front (&open_inodes, &inode->elem);
   inode->sector = sector;
@@ -138,15 +178,37 @@ inode_open (block_sector_t sector)
   inode->deny_write_cnt = 0;
   inode->removed = false;
   block_read (fs_device, inode->sector, &inode->data);
+  rwlock_release_write (&open_inodes_lock);
   return inode;
 }
 
+/* Returns the open inode for SECTOR, or a null pointer if there
+   is none.  The caller must hold open_inodes_lock. */
+static struct inode *
+find_open_inode (block_sector_t sector)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
+       e = list_next (e)) 
+    {
+      struct inode *inode = list_entry (e, struct inode, elem);
+      if (inode->sector == sector) 
+        return inode;
+    }
+  return NULL;
+}
+
 /* Reopens and returns INODE. */
 struct inode *
 inode_reopen (struct inode *inode)
 {
   if (inode != NULL)
-    inode->open_cnt++;
+    {
+      rwlock_acquire_write (&inode->rw);
+      inode->open_cnt++;
+      rwlock_release_write (&inode->rw);
+    }
   return inode;
 }
 
@@ -168,10 +230,14 @@ inode_close (struct inode *inode)
     return;
 
   /* Release resources if this was the last opener. */
+  rwlock_acquire_write (&open_inodes_lock);
+  rwlock_acquire_write (&inode->rw);
   if (--inode->open_cnt == 0)
     {
       /* Remove from inode list and release lock. */
       list_remove (&inode->elem);
+      rwlock_release_write (&inode->rw);
+      rwlock_release_write (&open_inodes_lock);
  
       /* Deallocate blocks if removed. */
       if (inode->removed) 
@@ -181,7 +247,12 @@ inode_close (struct inode *inode)
                             bytes_to_sectors (inode->data.length)); 
         }
 
-      free (inode); 
+      kmem_cache_free (&inode_cache, inode);
+    }
+  else
+    {
+      rwlock_release_write (&inode->rw);
+      rwlock_release_write (&open_inodes_lock);
     }
 }
 
@@ -191,7 +262,9 @@ void
 inode_remove (struct inode *inode) 
 {
   ASSERT (inode != NULL);
+  rwlock_acquire_write (&inode->rw);
   inode->removed = true;
+  rwlock_release_write (&inode->rw);
 }
 
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
@@ -204,6 +277,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
   off_t bytes_read = 0;
   uint8_t *bounce = NULL;
 
+  rwlock_acquire_read (&inode->rw);
   while (size > 0) 
     {
       /* Disk sector to read, starting byte offset within sector. */
@@ -211,7 +285,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
 
       /* Bytes left in inode, bytes left in sector, lesser of the two. */
-      off_t inode_left = inode_length (inode) - offset;
+      off_t inode_left = inode->data.length - offset;
       int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
       int min_left = inode_left < sector_left ? inode_left : sector_left;
 
@@ -244,6 +318,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       offset += chunk_size;
       bytes_read += chunk_size;
     }
+  rwlock_release_read (&inode->rw);
   free (bounce);
 
   return bytes_read;
@@ -262,8 +337,12 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
   off_t bytes_written = 0;
   uint8_t *bounce = NULL;
 
+  rwlock_acquire_write (&inode->rw);
   if (inode->deny_write_cnt)
-    return 0;
+    {
+      rwlock_release_write (&inode->rw);
+      return 0;
+    }
 
   while (size > 0) 
     {
@@ -272,7 +351,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
 
       /* Bytes left in inode, bytes left in sector, lesser of the two. */
-      off_t inode_left = inode_length (inode) - offset;
+      off_t inode_left = inode->data.length - offset;
       int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
       int min_left = inode_left < sector_left ? inode_left : sector_left;
 
@@ -312,6 +391,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       offset += chunk_size;
       bytes_written += chunk_size;
     }
+  rwlock_release_write (&inode->rw);
   free (bounce);
 
   return bytes_written;
@@ -322,8 +402,10 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 void
 inode_deny_write (struct inode *inode) 
 {
+  rwlock_acquire_write (&inode->rw);
   inode->deny_write_cnt++;
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
+  rwlock_release_write (&inode->rw);
 }
 
 /* Re-enables writes to INODE.
@@ -332,12 +414,15 @@ inode_deny_write (struct inode *inode)
 void
 inode_allow_write (struct inode *inode) 
 {
+  rwlock_acquire_write (&inode->rw);
   ASSERT (inode->deny_write_cnt > 0);
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
   inode->deny_write_cnt--;
+  rwlock_release_write (&inode->rw);
 }
 
-/* Returns the length, in bytes, of INODE's data. */
+/* Returns the length, in bytes, of INODE's data.  Inodes do not
+   grow, so this needs no locking. */
 off_t
 inode_length (const struct inode *inode)
 {
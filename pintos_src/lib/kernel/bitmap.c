@@ -3,6 +3,7 @@
 #include <limits.h>
 #include <round.h>
 #include <stdio.h>
+#include <string.h>
 #include "threads/malloc.h"
 #ifdef FILESYS
 #include "filesys/file.h"
@@ -23,11 +24,23 @@ typedef unsigned long elem_type;
 
 /* From the outside, a bitmap is an array of bits.  From the
    inside, it's an array of elem_type (defined above) that
-   simulates an array of bits. */
+   simulates an array of bits.
+
+   Searches work on whole elements, so a run of bits is found in
+   O(bit_cnt / ELEM_BITS) element tests rather than O(bit_cnt *
+   cnt) bit tests.  To speed up searching for false bits in large
+   bitmaps, a second-level summary has one bit per element, set
+   when every bit in that element is true, so that searches skip
+   ELEM_BITS full elements at a time.  Setting a single bit is
+   atomic, as before, but the summary is only kept exact if
+   modifications of a given bitmap are serialized, as they are in
+   all of the bitmap's users. */
 struct bitmap
   {
     size_t bit_cnt;     /* Number of bits. */
     elem_type *bits;    /* Elements that represent bits. */
+    elem_type *full;    /* Summary: one bit per full element. */
+    size_t next;        /* Next-fit cursor for scans. */
   };
 
 /* Returns the index of the element that contains the bit
@@ -60,6 +73,14 @@ byte_cnt (size_t bit_cnt)
   return sizeof (elem_type) * elem_cnt (bit_cnt);
 }
 
+/* Returns the number of bytes required for BIT_CNT bits and
+   their summary. */
+static inline size_t
+total_byte_cnt (size_t bit_cnt)
+{
+  return byte_cnt (bit_cnt) + byte_cnt (elem_cnt (bit_cnt));
+}
+
 /* Returns a bit mask in which the bits actually used in the last
    element of B's bits are set to 1 and the rest are set to 0. */
 static inline elem_type
@@ -68,6 +89,95 @@ last_mask (const struct bitmap *b)
   int last_bits = b->bit_cnt % ELEM_BITS;
   return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
+
+/* Returns a bit mask of the bits in element IDX that represent
+   bits START through END - 1. */
+static inline elem_type
+range_mask (size_t idx, size_t start, size_t end) 
+{
+  size_t first = idx * ELEM_BITS;
+  elem_type mask = (elem_type) -1;
+
+  if (start > first)
+    mask &= (elem_type) -1 << (start - first);
+  if (end < first + ELEM_BITS)
+    mask &= ((elem_type) 1 << (end - first)) - 1;
+  return mask;
+}
+
+/* Returns the number of 1-bits in WORD, by adding up adjacent
+   bit fields of doubling width.  The kernel is not linked with
+   libgcc, so __builtin_popcountl() is unavailable. */
+static inline size_t
+popcount (elem_type word) 
+{
+  const elem_type ones = (elem_type) -1;
+
+  word = word - ((word >> 1) & (ones / 3));
+  word = (word & (ones / 15 * 3)) + ((word >> 2) & (ones / 15 * 3));
+  word = (word + (word >> 4)) & (ones / 255 * 15);
+  return (elem_type) (word * (ones / 255)) >> (ELEM_BITS - CHAR_BIT);
+}
+
+/* Brings the summary bit for element IDX of B up to date. */
+static inline void
+update_full (struct bitmap *b, size_t idx) 
+{
+  elem_type mask = idx == elem_cnt (b->bit_cnt) - 1
+                   ? last_mask (b) : (elem_type) -1;
+
+  if ((b->bits[idx] & mask) == mask)
+    b->full[elem_idx (idx)] |= bit_mask (idx);
+  else
+    b->full[elem_idx (idx)] &= ~bit_mask (idx);
+}
+
+/* Returns the index of the first element at or after IDX in B
+   that has a false bit, or elem_cnt(B->bit_cnt) if there is
+   none. */
+static size_t
+next_nonfull (const struct bitmap *b, size_t idx) 
+{
+  size_t cnt = elem_cnt (b->bit_cnt);
+  size_t sidx = elem_idx (idx);
+  elem_type word;
+
+  if (idx >= cnt)
+    return cnt;
+  word = ~b->full[sidx] & ((elem_type) -1 << (idx % ELEM_BITS));
+  while (word == 0)
+    {
+      if (++sidx >= elem_cnt (cnt))
+        return cnt;
+      word = ~b->full[sidx];
+    }
+  idx = sidx * ELEM_BITS + __builtin_ctzl (word);
+  return idx < cnt ? idx : cnt;
+}
+
+/* Returns the index of the first bit at or after START in B that
+   is set to VALUE, or B->bit_cnt if there is none. */
+static size_t
+next_bit (const struct bitmap *b, size_t start, bool value) 
+{
+  size_t cnt = elem_cnt (b->bit_cnt);
+  size_t idx = elem_idx (start);
+  elem_type word;
+
+  if (start >= b->bit_cnt)
+    return b->bit_cnt;
+  word = (value ? b->bits[idx] : ~b->bits[idx])
+         & ((elem_type) -1 << (start % ELEM_BITS));
+  while (word == 0)
+    {
+      idx = value ? idx + 1 : next_nonfull (b, idx + 1);
+      if (idx >= cnt)
+        return b->bit_cnt;
+      word = value ? b->bits[idx] : ~b->bits[idx];
+    }
+  start = idx * ELEM_BITS + __builtin_ctzl (word);
+  return start < b->bit_cnt ? start : b->bit_cnt;
+}
 
 /* Creation and destruction. */
 
@@ -82,9 +192,12 @@ bitmap_create (size_t bit_cnt)
   if (b != NULL)
     {
       b->bit_cnt = bit_cnt;
-      b->bits = malloc (byte_cnt (bit_cnt));
+      b->bits = malloc (total_byte_cnt (bit_cnt));
+      b->full = b->bits + elem_cnt (bit_cnt);
+      b->next = 0;
       if (b->bits != NULL || bit_cnt == 0)
         {
+          memset (b->full, 0, byte_cnt (elem_cnt (bit_cnt)));
           bitmap_set_all (b, false);
           return b;
         }
@@ -105,6 +218,9 @@ bitmap_create_in_buf (size_t bit_cnt, void *block, size_t block_size UNUSED)
 
   b->bit_cnt = bit_cnt;
   b->bits = (elem_type *) (b + 1);
+  b->full = b->bits + elem_cnt (bit_cnt);
+  b->next = 0;
+  memset (b->full, 0, byte_cnt (elem_cnt (bit_cnt)));
   bitmap_set_all (b, false);
   return b;
 }
@@ -114,7 +230,7 @@ bitmap_create_in_buf (size_t bit_cnt, void *block, size_t block_size UNUSED)
 size_t
 bitmap_buf_size (size_t bit_cnt) 
 {
-  return sizeof (struct bitmap) + byte_cnt (bit_cnt);
+  return sizeof (struct bitmap) + total_byte_cnt (bit_cnt);
 }
 
 /* Destroys bitmap B, freeing its storage.
@@ -164,6 +280,7 @@ bitmap_mark (struct bitmap *b, size_t bit_idx)
      is guaranteed to be atomic on a uniprocessor machine.  See
      the description of the OR instruction in [IA32-v2b]. */
   asm ("orl %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+  update_full (b, idx);
 }
 
 /* Atomically sets the bit numbered BIT_IDX in B to false. */
@@ -177,6 +294,7 @@ bitmap_reset (struct bitmap *b, size_t bit_idx)
      is guaranteed to be atomic on a uniprocessor machine.  See
      the description of the AND instruction in [IA32-v2a]. */
   asm ("andl %1, %0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+  update_full (b, idx);
 }
 
 /* Atomically toggles the bit numbered IDX in B;
@@ -192,6 +310,7 @@ bitmap_flip (struct bitmap *b, size_t bit_idx)
      is guaranteed to be atomic on a uniprocessor machine.  See
      the description of the XOR instruction in [IA32-v2b]. */
   asm ("xorl %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+  update_full (b, idx);
 }
 
 /* Returns the value of the bit numbered IDX in B. */
@@ -214,18 +333,29 @@ bitmap_set_all (struct bitmap *b, bool value)
   bitmap_set_multiple (b, 0, bitmap_size (b), value);
 }
 
-/* Sets the CNT bits starting at START in B to VALUE. */
+/* Sets the CNT bits starting at START in B to VALUE.  Each
+   element is updated atomically. */
 void
 bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
+  size_t end = start + cnt;
+  size_t idx;
   
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    bitmap_set (b, start + i, value);
+  if (cnt == 0)
+    return;
+  for (idx = elem_idx (start); idx <= elem_idx (end - 1); idx++) 
+    {
+      elem_type mask = range_mask (idx, start, end);
+      if (value)
+        asm ("orl %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+      else
+        asm ("andl %1, %0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+      update_full (b, idx);
+    }
 }
 
 /* Returns the number of bits in B between START and START + CNT,
@@ -233,17 +363,19 @@ bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value)
 size_t
 bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i, value_cnt;
+  size_t end = start + cnt;
+  size_t idx, true_cnt;
 
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  value_cnt = 0;
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      value_cnt++;
-  return value_cnt;
+  if (cnt == 0)
+    return 0;
+  true_cnt = 0;
+  for (idx = elem_idx (start); idx <= elem_idx (end - 1); idx++)
+    true_cnt += popcount (b->bits[idx] & range_mask (idx, start, end));
+  return value ? true_cnt : cnt - true_cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -251,15 +383,21 @@ bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value)
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
+  size_t end = start + cnt;
+  size_t idx;
   
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      return true;
+  if (cnt == 0)
+    return false;
+  for (idx = elem_idx (start); idx <= elem_idx (end - 1); idx++) 
+    {
+      elem_type word = value ? b->bits[idx] : ~b->bits[idx];
+      if ((word & range_mask (idx, start, end)) != 0)
+        return true;
+    }
   return false;
 }
 
@@ -299,15 +437,25 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value)
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
 
-  if (cnt <= b->bit_cnt) 
+  if (cnt > b->bit_cnt - start)
+    return BITMAP_ERROR;
+  if (cnt == 0)
+    return start;
+
+  /* Find each run of VALUE bits in turn until one is long
+     enough. */
+  for (;;) 
     {
-      size_t last = b->bit_cnt - cnt;
-      size_t i;
-      for (i = start; i <= last; i++)
-        if (!bitmap_contains (b, i, cnt, !value))
-          return i; 
+      size_t end;
+
+      start = next_bit (b, start, value);
+      if (cnt > b->bit_cnt - start)
+        return BITMAP_ERROR;
+      end = next_bit (b, start, !value);
+      if (end - start >= cnt)
+        return start;
+      start = end;
     }
-  return BITMAP_ERROR;
 }
 
 /* Finds the first group of CNT consecutive bits in B at or after
@@ -325,6 +473,25 @@ bitmap_scan_and_flip (struct bitmap *b, size_t start, size_t cnt, bool value)
     bitmap_set_multiple (b, idx, cnt, !value);
   return idx;
 }
+
+/* Like bitmap_scan_and_flip(), but searches next-fit: from just
+   past the group found by the previous call, wrapping around to
+   the beginning of B if necessary, so that successive calls do
+   not all rescan the groups at the start of B. */
+size_t
+bitmap_scan_and_flip_next (struct bitmap *b, size_t cnt, bool value)
+{
+  size_t start = b->next <= b->bit_cnt ? b->next : 0;
+  size_t idx = bitmap_scan (b, start, cnt, value);
+  if (idx == BITMAP_ERROR && start > 0)
+    idx = bitmap_scan (b, 0, cnt, value);
+  if (idx != BITMAP_ERROR) 
+    {
+      bitmap_set_multiple (b, idx, cnt, !value);
+      b->next = idx + cnt;
+    }
+  return idx;
+}
 
 /* File input and output. */
 
@@ -345,8 +512,12 @@ bitmap_read (struct bitmap *b, struct file *file)
   if (b->bit_cnt > 0) 
     {
       off_t size = byte_cnt (b->bit_cnt);
+      size_t idx;
+
       success = file_read_at (file, b->bits, size, 0) == size;
       b->bits[elem_cnt (b->bit_cnt) - 1] &= last_mask (b);
+      for (idx = 0; idx < elem_cnt (b->bit_cnt); idx++)
+        update_full (b, idx);
     }
   return success;
 }
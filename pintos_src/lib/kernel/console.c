@@ -148,13 +148,16 @@ puts (const char *s)
   return 0;
 }
 
-/* Writes the N characters in BUFFER to the console. */
+/* Writes the N characters in BUFFER to the console.  The serial
+   port gets them in bulk rather than one at a time. */
 void
 putbuf (const char *buffer, size_t n) 
 {
   acquire_console ();
+  write_cnt += n;
+  serial_write (buffer, n);
   while (n-- > 0)
-    putchar_have_lock (*buffer++);
+    vga_putc (*buffer++);
   release_console ();
 }
 
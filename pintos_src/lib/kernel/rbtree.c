@@ -0,0 +1,353 @@
+#include "rbtree.h"
+#include "../debug.h"
+
+/* Red-black tree, following the presentation in [CLRS]
+   chapter 13, with null pointers standing in for the black
+   leaves.  The invariants are:
+
+     - Every element is red or black, and the root is black.
+
+     - A red element has no red child.
+
+     - Every path from an element down to a null leaf passes
+       through the same number of black elements.
+
+   Together these keep the tree's height below 2 lg (n + 1). */
+
+static void rotate_left (struct rbtree *, struct rbtree_elem *);
+static void rotate_right (struct rbtree *, struct rbtree_elem *);
+static void transplant (struct rbtree *, struct rbtree_elem *,
+                        struct rbtree_elem *);
+static void insert_fixup (struct rbtree *, struct rbtree_elem *);
+static void remove_fixup (struct rbtree *, struct rbtree_elem *,
+                          struct rbtree_elem *);
+
+/* Returns true if E is non-null and red. */
+static inline bool
+is_red (const struct rbtree_elem *e)
+{
+  return e != NULL && e->red;
+}
+
+/* Returns the leftmost element in the subtree rooted at E. */
+static inline struct rbtree_elem *
+subtree_min (struct rbtree_elem *e)
+{
+  while (e->left != NULL)
+    e = e->left;
+  return e;
+}
+
+/* Initializes TREE as an empty tree ordered by LESS given
+   auxiliary data AUX. */
+void
+rbtree_init (struct rbtree *tree, rbtree_less_func *less, void *aux)
+{
+  ASSERT (tree != NULL);
+  ASSERT (less != NULL);
+
+  tree->root = NULL;
+  tree->min = NULL;
+  tree->less = less;
+  tree->aux = aux;
+}
+
+/* Inserts ELEM into TREE, after any elements that compare equal
+   to it. */
+void
+rbtree_insert (struct rbtree *tree, struct rbtree_elem *elem)
+{
+  struct rbtree_elem *parent = NULL;
+  struct rbtree_elem **link = &tree->root;
+  bool leftmost = true;
+
+  ASSERT (tree != NULL);
+  ASSERT (elem != NULL);
+
+  while (*link != NULL)
+    {
+      parent = *link;
+      if (tree->less (elem, parent, tree->aux))
+        link = &parent->left;
+      else
+        {
+          link = &parent->right;
+          leftmost = false;
+        }
+    }
+
+  elem->parent = parent;
+  elem->left = elem->right = NULL;
+  elem->red = true;
+  *link = elem;
+  if (leftmost)
+    tree->min = elem;
+
+  insert_fixup (tree, elem);
+}
+
+/* Removes ELEM, which must be in TREE, from TREE. */
+void
+rbtree_remove (struct rbtree *tree, struct rbtree_elem *elem)
+{
+  struct rbtree_elem *y = elem;
+  struct rbtree_elem *x, *x_parent;
+  bool y_was_red = y->red;
+
+  ASSERT (tree != NULL);
+  ASSERT (elem != NULL);
+
+  if (tree->min == elem)
+    tree->min = rbtree_next (elem);
+
+  if (elem->left == NULL)
+    {
+      x = elem->right;
+      x_parent = elem->parent;
+      transplant (tree, elem, elem->right);
+    }
+  else if (elem->right == NULL)
+    {
+      x = elem->left;
+      x_parent = elem->parent;
+      transplant (tree, elem, elem->left);
+    }
+  else
+    {
+      y = subtree_min (elem->right);
+      y_was_red = y->red;
+      x = y->right;
+      if (y->parent == elem)
+        x_parent = y;
+      else
+        {
+          x_parent = y->parent;
+          transplant (tree, y, y->right);
+          y->right = elem->right;
+          y->right->parent = y;
+        }
+      transplant (tree, elem, y);
+      y->left = elem->left;
+      y->left->parent = y;
+      y->red = elem->red;
+    }
+
+  if (!y_was_red)
+    remove_fixup (tree, x, x_parent);
+}
+
+/* Returns TREE's minimum element, or a null pointer if TREE is
+   empty. */
+struct rbtree_elem *
+rbtree_min (const struct rbtree *tree)
+{
+  ASSERT (tree != NULL);
+
+  return tree->min;
+}
+
+/* Returns the element that follows ELEM in its tree's order, or
+   a null pointer if ELEM is the maximum. */
+struct rbtree_elem *
+rbtree_next (const struct rbtree_elem *elem)
+{
+  ASSERT (elem != NULL);
+
+  if (elem->right != NULL)
+    return subtree_min (elem->right);
+  while (elem->parent != NULL && elem == elem->parent->right)
+    elem = elem->parent;
+  return elem->parent;
+}
+
+/* Returns true if TREE is empty, false otherwise. */
+bool
+rbtree_empty (const struct rbtree *tree)
+{
+  ASSERT (tree != NULL);
+
+  return tree->root == NULL;
+}
+
+/* Rotates the subtree rooted at X to the left, making X's right
+   child its parent. */
+static void
+rotate_left (struct rbtree *tree, struct rbtree_elem *x)
+{
+  struct rbtree_elem *y = x->right;
+
+  x->right = y->left;
+  if (y->left != NULL)
+    y->left->parent = x;
+  transplant (tree, x, y);
+  y->left = x;
+  x->parent = y;
+}
+
+/* Rotates the subtree rooted at X to the right, making X's left
+   child its parent. */
+static void
+rotate_right (struct rbtree *tree, struct rbtree_elem *x)
+{
+  struct rbtree_elem *y = x->left;
+
+  x->left = y->right;
+  if (y->right != NULL)
+    y->right->parent = x;
+  transplant (tree, x, y);
+  y->right = x;
+  x->parent = y;
+}
+
+/* Replaces the subtree rooted at U by the one rooted at V, which
+   may be null. */
+static void
+transplant (struct rbtree *tree, struct rbtree_elem *u,
+            struct rbtree_elem *v)
+{
+  if (u->parent == NULL)
+    tree->root = v;
+  else if (u == u->parent->left)
+    u->parent->left = v;
+  else
+    u->parent->right = v;
+  if (v != NULL)
+    v->parent = u->parent;
+}
+
+/* Restores the red-black invariants after inserting red
+   element Z. */
+static void
+insert_fixup (struct rbtree *tree, struct rbtree_elem *z)
+{
+  struct rbtree_elem *p;
+
+  while ((p = z->parent) != NULL && p->red)
+    {
+      struct rbtree_elem *g = p->parent;
+
+      if (p == g->left)
+        {
+          struct rbtree_elem *u = g->right;
+          if (is_red (u))
+            {
+              p->red = u->red = false;
+              g->red = true;
+              z = g;
+            }
+          else
+            {
+              if (z == p->right)
+                {
+                  z = p;
+                  rotate_left (tree, z);
+                  p = z->parent;
+                }
+              p->red = false;
+              g->red = true;
+              rotate_right (tree, g);
+            }
+        }
+      else
+        {
+          struct rbtree_elem *u = g->left;
+          if (is_red (u))
+            {
+              p->red = u->red = false;
+              g->red = true;
+              z = g;
+            }
+          else
+            {
+              if (z == p->left)
+                {
+                  z = p;
+                  rotate_right (tree, z);
+                  p = z->parent;
+                }
+              p->red = false;
+              g->red = true;
+              rotate_left (tree, g);
+            }
+        }
+    }
+  tree->root->red = false;
+}
+
+/* Restores the red-black invariants after removing a black
+   element.  X, which may be null, is the element that took its
+   place, and X_PARENT is X's parent. */
+static void
+remove_fixup (struct rbtree *tree, struct rbtree_elem *x,
+              struct rbtree_elem *x_parent)
+{
+  while (x != tree->root && !is_red (x))
+    {
+      if (x == x_parent->left)
+        {
+          struct rbtree_elem *w = x_parent->right;
+          if (w->red)
+            {
+              w->red = false;
+              x_parent->red = true;
+              rotate_left (tree, x_parent);
+              w = x_parent->right;
+            }
+          if (!is_red (w->left) && !is_red (w->right))
+            {
+              w->red = true;
+              x = x_parent;
+              x_parent = x->parent;
+            }
+          else
+            {
+              if (!is_red (w->right))
+                {
+                  w->left->red = false;
+                  w->red = true;
+                  rotate_right (tree, w);
+                  w = x_parent->right;
+                }
+              w->red = x_parent->red;
+              x_parent->red = false;
+              w->right->red = false;
+              rotate_left (tree, x_parent);
+              x = tree->root;
+            }
+        }
+      else
+        {
+          struct rbtree_elem *w = x_parent->left;
+          if (w->red)
+            {
+              w->red = false;
+              x_parent->red = true;
+              rotate_right (tree, x_parent);
+              w = x_parent->left;
+            }
+          if (!is_red (w->left) && !is_red (w->right))
+            {
+              w->red = true;
+              x = x_parent;
+              x_parent = x->parent;
+            }
+          else
+            {
+              if (!is_red (w->left))
+                {
+                  w->right->red = false;
+                  w->red = true;
+                  rotate_left (tree, w);
+                  w = x_parent->left;
+                }
+              w->red = x_parent->red;
+              x_parent->red = false;
+              w->left->red = false;
+              rotate_right (tree, x_parent);
+              x = tree->root;
+            }
+        }
+    }
+  if (x != NULL)
+    x->red = false;
+}
@@ -0,0 +1,63 @@
+#ifndef __LIB_KERNEL_RBTREE_H
+#define __LIB_KERNEL_RBTREE_H
+
+/* Red-black tree.
+
+   This is a balanced binary search tree with O(log n) insertion
+   and removal.  Like lists and hash tables, it does not use
+   dynamic allocation: each structure that can be in a tree must
+   embed a struct rbtree_elem member, and the rbtree_entry macro
+   converts a struct rbtree_elem back into the structure that
+   contains it.
+
+   The tree keeps track of its minimum element, so rbtree_min()
+   is O(1).  Elements that compare equal are kept in insertion
+   order, so a tree used as a priority queue is FIFO among equal
+   keys. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Tree element. */
+struct rbtree_elem 
+  {
+    struct rbtree_elem *parent; /* Parent, or null for the root. */
+    struct rbtree_elem *left;   /* Left child, or null. */
+    struct rbtree_elem *right;  /* Right child, or null. */
+    bool red;                   /* Node color. */
+  };
+
+/* Compares the value of two tree elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool rbtree_less_func (const struct rbtree_elem *a,
+                               const struct rbtree_elem *b,
+                               void *aux);
+
+/* Red-black tree. */
+struct rbtree 
+  {
+    struct rbtree_elem *root;   /* Root, or null if empty. */
+    struct rbtree_elem *min;    /* Leftmost element, or null if empty. */
+    rbtree_less_func *less;     /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+/* Converts pointer to tree element RBTREE_ELEM into a pointer to
+   the structure that RBTREE_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the tree element. */
+#define rbtree_entry(RBTREE_ELEM, STRUCT, MEMBER)               \
+        ((STRUCT *) ((uint8_t *) &(RBTREE_ELEM)->parent         \
+                     - offsetof (STRUCT, MEMBER.parent)))
+
+void rbtree_init (struct rbtree *, rbtree_less_func *, void *aux);
+void rbtree_insert (struct rbtree *, struct rbtree_elem *);
+void rbtree_remove (struct rbtree *, struct rbtree_elem *);
+
+struct rbtree_elem *rbtree_min (const struct rbtree *);
+struct rbtree_elem *rbtree_next (const struct rbtree_elem *);
+bool rbtree_empty (const struct rbtree *);
+
+#endif /* lib/kernel/rbtree.h */
@@ -28,7 +28,19 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* User-space synchronization. */
+    SYS_FUTEX_WAIT,             /* Sleep while a word holds a value. */
+    SYS_FUTEX_WAKE,             /* Wake threads sleeping on a word. */
+
+    /* Process creation. */
+    SYS_FORK                    /* Clone this process. */
   };
 
+/* Results of SYS_FUTEX_WAIT. */
+#define FUTEX_WOKEN 0           /* Woken by SYS_FUTEX_WAKE. */
+#define FUTEX_MISMATCH 1        /* Word did not hold the expected value. */
+#define FUTEX_TIMEDOUT 2        /* Timeout expired before a wakeup. */
+
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,143 @@
+#include "synch.h"
+#include <debug.h>
+#include <limits.h>
+#include <stddef.h>
+#include <syscall.h>
+
+/* Atomically stores NEW_VALUE into *P and returns the old value.
+   XCHG with a memory operand is implicitly locked. */
+static inline int
+atomic_xchg (volatile int *p, int new_value)
+{
+  asm volatile ("xchgl %0, %1" : "+r" (new_value), "+m" (*p) : : "memory");
+  return new_value;
+}
+
+/* Atomically stores NEW_VALUE into *P if it holds OLD_VALUE.
+   Returns the value *P held beforehand either way. */
+static inline int
+atomic_cmpxchg (volatile int *p, int old_value, int new_value)
+{
+  asm volatile ("lock cmpxchgl %2, %1"
+                : "+a" (old_value), "+m" (*p)
+                : "r" (new_value)
+                : "memory");
+  return old_value;
+}
+
+/* Atomically adds DELTA to *P and returns the old value. */
+static inline int
+atomic_add (volatile int *p, int delta)
+{
+  asm volatile ("lock xaddl %0, %1" : "+r" (delta), "+m" (*p) : : "memory");
+  return delta;
+}
+
+/* Initializes MUTEX as unlocked. */
+void
+mutex_init (struct mutex *mutex) 
+{
+  ASSERT (mutex != NULL);
+
+  mutex->state = 0;
+}
+
+/* Sleeps until MUTEX can be taken, marking it as possibly having
+   waiters so that the eventual unlocker wakes one of them. */
+static void
+mutex_lock_slow (struct mutex *mutex) 
+{
+  while (atomic_xchg (&mutex->state, 2) != 0)
+    futex_wait ((int *) &mutex->state, 2, 0);
+}
+
+/* Acquires MUTEX, sleeping until it becomes available if
+   necessary.  Mutexes are not recursive. */
+void
+mutex_lock (struct mutex *mutex) 
+{
+  ASSERT (mutex != NULL);
+
+  if (atomic_cmpxchg (&mutex->state, 0, 1) != 0)
+    mutex_lock_slow (mutex);
+}
+
+/* Tries to acquire MUTEX without sleeping.  Returns true if
+   successful, false on failure. */
+bool
+mutex_trylock (struct mutex *mutex) 
+{
+  ASSERT (mutex != NULL);
+
+  return atomic_cmpxchg (&mutex->state, 0, 1) == 0;
+}
+
+/* Releases MUTEX, which the caller must hold, and wakes one
+   waiter if there might be any. */
+void
+mutex_unlock (struct mutex *mutex) 
+{
+  ASSERT (mutex != NULL);
+
+  if (atomic_xchg (&mutex->state, 0) == 2)
+    futex_wake ((int *) &mutex->state, 1);
+}
+
+/* Initializes condition variable COND. */
+void
+cond_init (struct condition *cond) 
+{
+  ASSERT (cond != NULL);
+
+  cond->seq = 0;
+  cond->waiters = 0;
+}
+
+/* Atomically releases MUTEX and waits for COND to be signaled,
+   then reacquires MUTEX before returning.  MUTEX must be held.
+   As with any condition variable, the caller should recheck its
+   condition after waking, since wakeups may be spurious.
+
+   A signal that lands between reading COND's sequence number
+   and sleeping changes the futex word, so the sleep returns at
+   once instead of missing it. */
+void
+cond_wait (struct condition *cond, struct mutex *mutex) 
+{
+  int seq;
+
+  ASSERT (cond != NULL);
+  ASSERT (mutex != NULL);
+
+  atomic_add (&cond->waiters, 1);
+  seq = cond->seq;
+  mutex_unlock (mutex);
+  futex_wait ((int *) &cond->seq, seq, 0);
+  atomic_add (&cond->waiters, -1);
+
+  /* Other threads may have been woken with us, so relock as a
+     contended mutex to make sure they are woken in turn. */
+  mutex_lock_slow (mutex);
+}
+
+/* Wakes one thread waiting on COND, if any. */
+void
+cond_signal (struct condition *cond) 
+{
+  ASSERT (cond != NULL);
+
+  atomic_add (&cond->seq, 1);
+  if (cond->waiters > 0)
+    futex_wake ((int *) &cond->seq, 1);
+}
+
+/* Wakes all threads waiting on COND. */
+void
+cond_broadcast (struct condition *cond) 
+{
+  ASSERT (cond != NULL);
+
+  atomic_add (&cond->seq, 1);
+  if (cond->waiters > 0)
+    futex_wake ((int *) &cond->seq, INT_MAX);
+}
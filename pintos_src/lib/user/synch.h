@@ -0,0 +1,32 @@
+#ifndef __LIB_USER_SYNCH_H
+#define __LIB_USER_SYNCH_H
+
+#include <stdbool.h>
+
+/* Mutex built on a futex.  The uncontended paths of
+   mutex_lock() and mutex_unlock() are a single atomic
+   instruction each and never enter the kernel. */
+struct mutex 
+  {
+    volatile int state;         /* 0=free, 1=held, 2=held with waiters. */
+  };
+
+void mutex_init (struct mutex *);
+void mutex_lock (struct mutex *);
+bool mutex_trylock (struct mutex *);
+void mutex_unlock (struct mutex *);
+
+/* Condition variable built on a futex.  Signaling a condition
+   with no waiters does not enter the kernel. */
+struct condition 
+  {
+    volatile int seq;           /* Bumped by every signal. */
+    volatile int waiters;       /* Threads in cond_wait(). */
+  };
+
+void cond_init (struct condition *);
+void cond_wait (struct condition *, struct mutex *);
+void cond_signal (struct condition *);
+void cond_broadcast (struct condition *);
+
+#endif /* lib/user/synch.h */
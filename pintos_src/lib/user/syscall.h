@@ -45,4 +45,11 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* User-space synchronization. */
+int futex_wait (int *addr, int expected, int timeout);
+int futex_wake (int *addr, int n);
+
+/* Process creation. */
+pid_t fork (void);
+
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,58 @@
+/* Runs an EDF thread, whose priority list is empty, next to
+   ordinary threads.  Once the EDF thread is off the run queue,
+   the scheduler must not believe that a thread at its priority
+   is still ready: it must run the main thread, and a thread of
+   lower priority must not preempt it. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func edf_thread;
+static thread_func low_thread;
+
+void
+test_edf_idle_queue (void) 
+{
+  struct semaphore done;
+
+  /* This test does not work with the MLFQS or the CFS. */
+  ASSERT (!thread_mlfqs && !thread_cfs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  sema_init (&done, 0);
+  if (thread_create_deadline ("edf", 20, 5, edf_thread, &done) == TID_ERROR)
+    fail ("thread_create_deadline failed");
+  msg ("Main thread running while EDF thread waits.");
+  sema_down (&done);
+
+  thread_create ("low", PRI_DEFAULT - 1, low_thread, NULL);
+  msg ("Low-priority thread should not have run yet.");
+  thread_set_priority (PRI_MIN);
+  msg ("Low-priority thread should have run.");
+}
+
+static void
+edf_thread (void *done_) 
+{
+  struct semaphore *done = done_;
+  int i;
+
+  for (i = 0; i < 3; i++) 
+    {
+      msg ("EDF job %d", i);
+      thread_wait_next_period ();
+    }
+  msg ("EDF thread done.");
+  sema_up (done);
+}
+
+static void
+low_thread (void *aux UNUSED) 
+{
+  msg ("Low-priority thread running.");
+}
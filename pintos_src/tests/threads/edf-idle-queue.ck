@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-idle-queue) begin
+(edf-idle-queue) EDF job 0
+(edf-idle-queue) Main thread running while EDF thread waits.
+(edf-idle-queue) EDF job 1
+(edf-idle-queue) EDF job 2
+(edf-idle-queue) EDF thread done.
+(edf-idle-queue) Low-priority thread should not have run yet.
+(edf-idle-queue) Low-priority thread running.
+(edf-idle-queue) Low-priority thread should have run.
+(edf-idle-queue) end
+EOF
+pass;
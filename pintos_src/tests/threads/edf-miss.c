@@ -0,0 +1,58 @@
+/* Runs an EDF thread whose first job spins for longer than its
+   budget, followed by a job that fits.  The overrun must be
+   counted as exactly one deadline miss: the job is suspended
+   until its next period, and finishing it there, within the new
+   period, is not a second miss. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* EDF thread parameters, in timer ticks. */
+#define PERIOD 20
+#define BUDGET 3
+#define OVERRUN 8               /* Length of the first job. */
+
+static thread_func edf_thread;
+
+void
+test_edf_miss (void) 
+{
+  struct semaphore done;
+  long long misses;
+
+  /* This test does not work with the MLFQS or the CFS. */
+  ASSERT (!thread_mlfqs && !thread_cfs);
+
+  misses = thread_get_edf_misses ();
+  sema_init (&done, 0);
+  if (thread_create_deadline ("edf", PERIOD, BUDGET,
+                              edf_thread, &done) == TID_ERROR)
+    fail ("thread_create_deadline failed");
+  sema_down (&done);
+
+  misses = thread_get_edf_misses () - misses;
+  if (misses != 1)
+    fail ("%lld deadline misses counted, should be 1", misses);
+  msg ("1 deadline miss counted.");
+}
+
+static void
+edf_thread (void *done_) 
+{
+  struct semaphore *done = done_;
+  int64_t start;
+
+  msg ("Job 0 runs past its budget.");
+  start = timer_ticks ();
+  while (timer_elapsed (start) < OVERRUN)
+    continue;
+  thread_wait_next_period ();
+
+  msg ("Job 1 fits in its budget.");
+  thread_wait_next_period ();
+  sema_up (done);
+}
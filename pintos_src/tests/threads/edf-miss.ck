@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-miss) begin
+(edf-miss) Job 0 runs past its budget.
+(edf-miss) Job 1 fits in its budget.
+(edf-miss) 1 deadline miss counted.
+(edf-miss) end
+EOF
+pass;
@@ -0,0 +1,55 @@
+/* Creates three EDF threads in the reverse of their deadline
+   order and has them all wake up on the same timer tick.  They
+   must then run in order of deadline, earliest first, whatever
+   order they were created or woken in. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+struct edf_info
+  {
+    int64_t start;              /* Tick at which all threads wake. */
+    struct semaphore done;      /* Upped by each thread when done. */
+  };
+
+static thread_func edf_thread;
+
+void
+test_edf_order (void) 
+{
+  static const int64_t periods[] = {300, 200, 100};
+  struct edf_info info;
+  size_t i;
+
+  /* This test does not work with the MLFQS or the CFS. */
+  ASSERT (!thread_mlfqs && !thread_cfs);
+
+  info.start = timer_ticks () + 10;
+  sema_init (&info.done, 0);
+  for (i = 0; i < sizeof periods / sizeof *periods; i++) 
+    {
+      char name[16];
+
+      snprintf (name, sizeof name, "period %d", (int) periods[i]);
+      if (thread_create_deadline (name, periods[i], 20,
+                                  edf_thread, &info) == TID_ERROR)
+        fail ("thread_create_deadline failed");
+    }
+  for (i = 0; i < sizeof periods / sizeof *periods; i++)
+    sema_down (&info.done);
+  msg ("All EDF threads done.");
+}
+
+static void
+edf_thread (void *info_) 
+{
+  struct edf_info *info = info_;
+
+  timer_sleep (info->start - timer_ticks ());
+  msg ("Thread with %s running.", thread_name ());
+  sema_up (&info->done);
+}
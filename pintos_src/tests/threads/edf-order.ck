@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-order) begin
+(edf-order) Thread with period 100 running.
+(edf-order) Thread with period 200 running.
+(edf-order) Thread with period 300 running.
+(edf-order) All EDF threads done.
+(edf-order) end
+EOF
+pass;
@@ -0,0 +1,50 @@
+/* Forks a child, then has the parent and the child each write
+   every byte of the same page.  Neither may see the other's
+   write.  The child waits to look at the page until the parent
+   has created a file, which it does after writing, so the order
+   does not depend on scheduling. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char page[4096];
+
+/* Returns true if every byte of page[] is C. */
+static bool
+page_is (char c) 
+{
+  size_t i;
+
+  for (i = 0; i < sizeof page; i++)
+    if (page[i] != c)
+      return false;
+  return true;
+}
+
+void
+test_main (void) 
+{
+  pid_t pid;
+  int status;
+
+  memset (page, 'a', sizeof page);
+  pid = fork ();
+  if (pid == 0) 
+    {
+      int fd;
+
+      while ((fd = open ("written")) == -1)
+        continue;
+      close (fd);
+      CHECK (page_is ('a'), "child does not see parent's write");
+      memset (page, 'c', sizeof page);
+      exit (81);
+    }
+  memset (page, 'p', sizeof page);
+  CHECK (create ("written", 0), "create \"written\"");
+  status = wait (pid);
+  CHECK (status == 81, "wait(fork()) = 81");
+  CHECK (page_is ('p'), "parent does not see child's write");
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fork-cow) begin
+(fork-cow) create "written"
+(fork-cow) child does not see parent's write
+fork-cow: exit(81)
+(fork-cow) wait(fork()) = 81
+(fork-cow) parent does not see child's write
+(fork-cow) end
+fork-cow: exit(0)
+EOF
+pass;
@@ -0,0 +1,45 @@
+/* Opens a file, reads part of it, and forks.  The child's copy
+   of the descriptor must be at the same position as the parent's,
+   and reading through one copy must not move the other. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SKIP 10
+#define CHUNK 32
+
+/* Checks that FD is at offset SKIP and that the next CHUNK
+   bytes read from it are the ones in sample[] there. */
+static void
+read_chunk (int fd, const char *who) 
+{
+  char buf[CHUNK];
+
+  CHECK (tell (fd) == SKIP, "%s: tell() = %d", who, SKIP);
+  CHECK (read (fd, buf, CHUNK) == CHUNK, "%s: read next %d bytes",
+         who, CHUNK);
+  compare_bytes (buf, sample + SKIP, CHUNK, SKIP, "sample.txt");
+}
+
+void
+test_main (void) 
+{
+  char buf[SKIP];
+  pid_t pid;
+  int fd;
+  int status;
+
+  CHECK ((fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (read (fd, buf, SKIP) == SKIP, "read %d bytes", SKIP);
+  pid = fork ();
+  if (pid == 0) 
+    {
+      read_chunk (fd, "child");
+      exit (81);
+    }
+  status = wait (pid);
+  CHECK (status == 81, "wait(fork()) = 81");
+  read_chunk (fd, "parent");
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fork-fd) begin
+(fork-fd) open "sample.txt"
+(fork-fd) read 10 bytes
+(fork-fd) child: tell() = 10
+(fork-fd) child: read next 32 bytes
+fork-fd: exit(81)
+(fork-fd) wait(fork()) = 81
+(fork-fd) parent: tell() = 10
+(fork-fd) parent: read next 32 bytes
+(fork-fd) end
+fork-fd: exit(0)
+EOF
+pass;
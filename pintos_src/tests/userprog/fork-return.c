@@ -0,0 +1,23 @@
+/* Forks a child and checks that fork() returns 0 in the child
+   and the child's pid in the parent.  The parent prints nothing
+   until the child is done, to keep the output in order. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  pid_t pid = fork ();
+  int status;
+
+  if (pid == 0) 
+    {
+      msg ("child: fork() = 0");
+      exit (81);
+    }
+  status = wait (pid);
+  CHECK (pid > 0, "parent: fork() returned a pid");
+  CHECK (status == 81, "wait(fork()) = 81");
+}
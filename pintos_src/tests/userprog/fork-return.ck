@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fork-return) begin
+(fork-return) child: fork() = 0
+fork-return: exit(81)
+(fork-return) parent: fork() returned a pid
+(fork-return) wait(fork()) = 81
+(fork-return) end
+fork-return: exit(0)
+EOF
+pass;
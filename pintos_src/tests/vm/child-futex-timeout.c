@@ -0,0 +1,28 @@
+/* Child process for futex-wake-timeout test.
+   Maps the file its parent mapped, takes turn 1, and sleeps on
+   it with a timeout shorter than a time slice.  Its parent wakes
+   it before the timeout expires. */
+
+#include <syscall.h>
+#include "tests/vm/futex-shared.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Timeout, in timer ticks, for our sleep. */
+#define TIMEOUT 3
+
+void
+test_main (void)
+{
+  int handle;
+  int result;
+
+  CHECK ((handle = open ("shared")) > 1, "open \"shared\"");
+  CHECK (mmap (handle, SHARED) != MAP_FAILED, "mmap \"shared\"");
+
+  SHARED->turn = 1;
+  futex_wake ((int *) &SHARED->turn, 1);
+  result = futex_wait ((int *) &SHARED->turn, 1, TIMEOUT);
+  SHARED->turn = 2;
+  CHECK (result == FUTEX_WOKEN, "woken before timeout");
+}
@@ -0,0 +1,22 @@
+/* Child process for futex-shared test.
+   Maps the file its parent mapped, takes turn 1, waits for
+   turn 2, and then increments the shared counter. */
+
+#include <syscall.h>
+#include "tests/vm/futex-shared.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  int handle;
+
+  CHECK ((handle = open ("shared")) > 1, "open \"shared\"");
+  CHECK (mmap (handle, SHARED) != MAP_FAILED, "mmap \"shared\"");
+
+  SHARED->turn = 1;
+  futex_wake ((int *) &SHARED->turn, 1);
+  wait_for (&SHARED->turn, 2);
+  add_count ();
+}
@@ -0,0 +1,39 @@
+/* Maps a file and runs child-futex, which maps the same file.
+   The two processes take turns through a futex in the mapping,
+   then both increment a counter in it under a futex-based
+   mutex.  Each must see the other's stores, and wake the other
+   with futex_wake(). */
+
+#include <syscall.h>
+#include "tests/vm/futex-shared.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  int handle;
+  pid_t child;
+
+  CHECK (create ("shared", 4096), "create \"shared\"");
+  CHECK ((handle = open ("shared")) > 1, "open \"shared\"");
+  CHECK (mmap (handle, SHARED) != MAP_FAILED, "mmap \"shared\"");
+  mutex_init (&SHARED->mutex);
+
+  /* The child takes turn 1 once it has mapped the file. */
+  CHECK ((child = exec ("child-futex")) != -1, "exec \"child-futex\"");
+  wait_for (&SHARED->turn, 1);
+  msg ("child took its turn");
+
+  /* Take turn 2, releasing the child, and count alongside it. */
+  SHARED->turn = 2;
+  futex_wake ((int *) &SHARED->turn, 1);
+  add_count ();
+  quiet = true;
+  CHECK (wait (child) == 0, "wait for child");
+  quiet = false;
+
+  if (SHARED->count != 2 * INCREMENTS)
+    fail ("count is %d, should be %d", SHARED->count, 2 * INCREMENTS);
+  msg ("count is %d", SHARED->count);
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(futex-shared) begin
+(futex-shared) create "shared"
+(futex-shared) open "shared"
+(futex-shared) mmap "shared"
+(futex-shared) exec "child-futex"
+(child-futex) begin
+(child-futex) open "shared"
+(child-futex) mmap "shared"
+(futex-shared) child took its turn
+(child-futex) end
+child-futex: exit(0)
+(futex-shared) count is 2000
+(futex-shared) end
+futex-shared: exit(0)
+EOF
+pass;
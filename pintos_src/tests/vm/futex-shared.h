@@ -0,0 +1,50 @@
+#ifndef TESTS_VM_FUTEX_SHARED_H
+#define TESTS_VM_FUTEX_SHARED_H
+
+#include <synch.h>
+#include <syscall-nr.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+/* Layout of the file that futex-shared and child-futex both
+   map. */
+struct shared 
+  {
+    volatile int turn;          /* Whose turn it is: 0, 1, or 2. */
+    struct mutex mutex;         /* Protects count. */
+    int count;                  /* Incremented by both processes. */
+  };
+
+/* Where each process maps the file. */
+#define SHARED ((struct shared *) 0x10000000)
+
+/* Increments of count made by each process. */
+#define INCREMENTS 1000
+
+/* Sleeps until *WORD holds VALUE.  Fails if it takes so long
+   that the other process's store was evidently never seen. */
+static void
+wait_for (volatile int *word, int value) 
+{
+  int cur;
+
+  while ((cur = *word) != value)
+    if (futex_wait ((int *) word, cur, 500) == FUTEX_TIMEDOUT)
+      fail ("timed out waiting for turn %d", value);
+}
+
+/* Increments count INCREMENTS times, under the shared mutex. */
+static void
+add_count (void) 
+{
+  int i;
+
+  for (i = 0; i < INCREMENTS; i++) 
+    {
+      mutex_lock (&SHARED->mutex);
+      SHARED->count++;
+      mutex_unlock (&SHARED->mutex);
+    }
+}
+
+#endif /* tests/vm/futex-shared.h */
@@ -0,0 +1,38 @@
+/* Maps a file and runs child-futex-timeout, which sleeps on a
+   futex in the mapping with a short timeout.  We wake the child
+   as soon as it is asleep and then keep the CPU until its
+   timeout has passed.  Since the child is no higher in priority,
+   waking it does not preempt us, so the deadline arrives while
+   the child is still waiting to run.  The expired timeout must
+   not wake it a second time. */
+
+#include <syscall.h>
+#include "tests/vm/futex-shared.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  int handle;
+  pid_t child;
+
+  CHECK (create ("shared", 4096), "create \"shared\"");
+  CHECK ((handle = open ("shared")) > 1, "open \"shared\"");
+  CHECK (mmap (handle, SHARED) != MAP_FAILED, "mmap \"shared\"");
+
+  /* The child takes turn 1 just before it goes to sleep. */
+  CHECK ((child = exec ("child-futex-timeout")) != -1,
+         "exec \"child-futex-timeout\"");
+  wait_for (&SHARED->turn, 1);
+  while (futex_wake ((int *) &SHARED->turn, 1) == 0)
+    continue;
+
+  /* Spin until the child runs again, which is only once our
+     time slice, longer than its timeout, is used up. */
+  while (SHARED->turn != 2)
+    continue;
+  quiet = true;
+  CHECK (wait (child) == 0, "wait for child");
+  quiet = false;
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(futex-wake-timeout) begin
+(futex-wake-timeout) create "shared"
+(futex-wake-timeout) open "shared"
+(futex-wake-timeout) mmap "shared"
+(futex-wake-timeout) exec "child-futex-timeout"
+(child-futex-timeout) begin
+(child-futex-timeout) open "shared"
+(child-futex-timeout) mmap "shared"
+(child-futex-timeout) woken before timeout
+(child-futex-timeout) end
+child-futex-timeout: exit(0)
+(futex-wake-timeout) end
+futex-wake-timeout: exit(0)
+EOF
+pass;
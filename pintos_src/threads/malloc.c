@@ -5,6 +5,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/memstat.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -66,6 +67,8 @@ static size_t desc_cnt;         /* Number of descriptors. */
 
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static void *do_malloc (size_t);
+static void do_free (void *);
 
 /* Initializes the malloc() descriptors. */
 void
@@ -88,6 +91,16 @@ malloc_init (void)
    Returns a null pointer if memory is not available. */
 void *
 malloc (size_t size) 
+{
+  void *p = do_malloc (size);
+  if (memstat_enabled)
+    memstat_alloc (MEMSTAT_MALLOC, p, size, __builtin_return_address (0));
+  return p;
+}
+
+/* Does the work of malloc(), without allocation accounting. */
+static void *
+do_malloc (size_t size) 
 {
   struct desc *d;
   struct block *b;
@@ -107,7 +120,7 @@ malloc (size_t size)
       /* SIZE is too big for any descriptor.
          Allocate enough pages to hold SIZE plus an arena. */
       size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PGSIZE);
-      a = palloc_get_multiple (0, page_cnt);
+      a = palloc_get_multiple (PAL_NOSTAT, page_cnt);
       if (a == NULL)
         return NULL;
 
@@ -127,7 +140,7 @@ malloc (size_t size)
       size_t i;
 
       /* Allocate a page. */
-      a = palloc_get_page (0);
+      a = palloc_get_page (PAL_NOSTAT);
       if (a == NULL) 
         {
           lock_release (&d->lock);
@@ -167,9 +180,11 @@ calloc (size_t a, size_t b)
     return NULL;
 
   /* Allocate and zero memory. */
-  p = malloc (size);
+  p = do_malloc (size);
   if (p != NULL)
     memset (p, 0, size);
+  if (memstat_enabled)
+    memstat_alloc (MEMSTAT_MALLOC, p, size, __builtin_return_address (0));
 
   return p;
 }
@@ -201,7 +216,7 @@ realloc (void *old_block, size_t new_size)
     }
   else 
     {
-      void *new_block = malloc (new_size);
+      void *new_block = do_malloc (new_size);
       if (old_block != NULL && new_block != NULL)
         {
           size_t old_size = block_size (old_block);
@@ -209,6 +224,9 @@ realloc (void *old_block, size_t new_size)
           memcpy (new_block, old_block, min_size);
           free (old_block);
         }
+      if (memstat_enabled)
+        memstat_alloc (MEMSTAT_MALLOC, new_block, new_size,
+                       __builtin_return_address (0));
       return new_block;
     }
 }
@@ -217,6 +235,15 @@ realloc (void *old_block, size_t new_size)
    malloc(), calloc(), or realloc(). */
 void
 free (void *p) 
+{
+  if (memstat_enabled)
+    memstat_free (p);
+  do_free (p);
+}
+
+/* Does the work of free(), without allocation accounting. */
+static void
+do_free (void *p) 
 {
   if (p != NULL)
     {
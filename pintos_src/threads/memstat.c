@@ -0,0 +1,286 @@
+#include "threads/memstat.h"
+#include <debug.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "threads/interrupt.h"
+
+/* Allocation accounting.
+
+   Each allocation is charged to its call site, the return
+   address of the call to malloc() or palloc, and to the size
+   class of the number of bytes requested.  Both keep live and
+   peak byte counts, so a site whose live bytes only ever grow in
+   a long run is a likely leak, and the peaks show how large
+   pools need to be.  The pages malloc() carves its blocks from
+   are not charged to palloc, so each byte is counted once.
+
+   The allocators themselves can't be used here, so everything
+   lives in fixed-size tables.  Live allocations are found again
+   at free time through an open-addressed hash table keyed by
+   address.  Allocations that don't fit in the tables are counted
+   but not tracked.  The tables are updated with interrupts off,
+   because palloc may be called with interrupts off. */
+
+/* If true, account for allocations.
+   Controlled by kernel command-line option "-memstat". */
+bool memstat_enabled;
+
+/* Number of call sites reported by memstat_dump().
+   Set by kernel command-line option "-memstat=N". */
+size_t memstat_top = 10;
+
+/* Maximum number of call sites. */
+#define SITE_CNT 256
+
+/* Maximum number of live allocations tracked.  A power of 2. */
+#define LIVE_CNT 4096
+
+/* Number of size classes: class K holds requests of 2**(K-1)+1
+   through 2**K bytes. */
+#define CLASS_CNT 32
+
+/* Allocation counters. */
+struct memstat_counts
+  {
+    size_t live_bytes;          /* Bytes allocated and not freed. */
+    size_t peak_bytes;          /* Maximum of live_bytes. */
+    size_t live_cnt;            /* Allocations not freed. */
+    long long alloc_cnt;        /* Total allocations. */
+  };
+
+/* A call site. */
+struct memstat_site
+  {
+    void *caller;                       /* Return address, or null if unused. */
+    enum memstat_kind kind;             /* Allocator called. */
+    struct memstat_counts counts;       /* Counters. */
+  };
+
+/* A live allocation. */
+struct memstat_live
+  {
+    void *ptr;                          /* Address, or null if unused. */
+    size_t size;                        /* Bytes requested. */
+    struct memstat_site *site;          /* Call site. */
+  };
+
+static struct memstat_site sites[SITE_CNT];
+static struct memstat_live lives[LIVE_CNT];
+static struct memstat_counts classes[CLASS_CNT];
+static struct memstat_counts totals[2];
+static long long untracked;
+
+static struct memstat_site *find_site (enum memstat_kind, void *caller);
+static size_t live_hash (const void *);
+static int size_class (size_t);
+static void count_alloc (struct memstat_counts *, size_t);
+static void count_free (struct memstat_counts *, size_t);
+static int site_compare (const void *, const void *);
+
+/* Records that the allocator of the given KIND, called from
+   CALLER, returned SIZE bytes at PTR.  Does nothing if PTR is
+   null. */
+void
+memstat_alloc (enum memstat_kind kind, void *ptr, size_t size, void *caller)
+{
+  struct memstat_site *site;
+  enum intr_level old_level;
+  size_t i;
+
+  if (ptr == NULL)
+    return;
+
+  old_level = intr_disable ();
+  site = find_site (kind, caller);
+  for (i = live_hash (ptr); lives[i].ptr != NULL; i = (i + 1) % LIVE_CNT)
+    continue;
+  if (site != NULL && totals[0].live_cnt + totals[1].live_cnt < LIVE_CNT - 1)
+    {
+      lives[i].ptr = ptr;
+      lives[i].size = size;
+      lives[i].site = site;
+      count_alloc (&site->counts, size);
+      count_alloc (&classes[size_class (size)], size);
+      count_alloc (&totals[kind], size);
+    }
+  else
+    untracked++;
+  intr_set_level (old_level);
+}
+
+/* Records that the allocation at PTR was freed.  Does nothing if
+   PTR was not tracked. */
+void
+memstat_free (void *ptr) 
+{
+  enum intr_level old_level;
+  size_t i, j;
+
+  if (ptr == NULL)
+    return;
+
+  old_level = intr_disable ();
+  for (i = live_hash (ptr); lives[i].ptr != NULL; i = (i + 1) % LIVE_CNT)
+    if (lives[i].ptr == ptr)
+      break;
+  if (lives[i].ptr != NULL)
+    {
+      struct memstat_live *l = &lives[i];
+      count_free (&l->site->counts, l->size);
+      count_free (&classes[size_class (l->size)], l->size);
+      count_free (&totals[l->site->kind], l->size);
+      l->ptr = NULL;
+
+      /* Move later entries of the same probe sequence back into
+         the hole, so that lookups never stop short.  See [Knuth]
+         6.4 Algorithm R. */
+      for (j = (i + 1) % LIVE_CNT; lives[j].ptr != NULL; j = (j + 1) % LIVE_CNT)
+        {
+          size_t home = live_hash (lives[j].ptr);
+          if ((j > i && (home <= i || home > j))
+              || (j < i && home <= i && home > j))
+            {
+              lives[i] = lives[j];
+              lives[j].ptr = NULL;
+              i = j;
+            }
+        }
+    }
+  intr_set_level (old_level);
+}
+
+/* Prints the memstat_top call sites with the most live bytes,
+   followed by totals per allocator and per size class. */
+void
+memstat_dump (void) 
+{
+  static const struct memstat_site *sorted[SITE_CNT];
+  size_t cnt = 0;
+  size_t i;
+
+  if (!memstat_enabled)
+    {
+      printf ("Allocation accounting is off (use -memstat).\n");
+      return;
+    }
+
+  for (i = 0; i < SITE_CNT; i++)
+    if (sites[i].caller != NULL)
+      sorted[cnt++] = &sites[i];
+  qsort (sorted, cnt, sizeof *sorted, site_compare);
+  if (cnt > memstat_top)
+    cnt = memstat_top;
+
+  printf ("Memory by call site, top %zu by live bytes:\n", cnt);
+  printf ("%-6s %10s %10s %8s %10s  %s\n", "alloc", "live", "peak",
+          "blocks", "allocs", "call site");
+  for (i = 0; i < cnt; i++)
+    printf ("%-6s %10zu %10zu %8zu %10lld  %p\n",
+            sorted[i]->kind == MEMSTAT_MALLOC ? "malloc" : "palloc",
+            sorted[i]->counts.live_bytes, sorted[i]->counts.peak_bytes,
+            sorted[i]->counts.live_cnt, sorted[i]->counts.alloc_cnt,
+            sorted[i]->caller);
+  printf ("Translate call sites with the `backtrace' program.\n");
+
+  printf ("Memory by size class:\n");
+  printf ("%10s %10s %10s %8s %10s\n", "size", "live", "peak",
+          "blocks", "allocs");
+  for (i = 0; i < CLASS_CNT; i++)
+    if (classes[i].alloc_cnt > 0)
+      printf ("%10zu %10zu %10zu %8zu %10lld\n", (size_t) 1 << i,
+              classes[i].live_bytes, classes[i].peak_bytes,
+              classes[i].live_cnt, classes[i].alloc_cnt);
+  printf ("malloc: %zu bytes live, %zu peak; "
+          "palloc: %zu bytes live, %zu peak\n",
+          totals[MEMSTAT_MALLOC].live_bytes,
+          totals[MEMSTAT_MALLOC].peak_bytes,
+          totals[MEMSTAT_PALLOC].live_bytes,
+          totals[MEMSTAT_PALLOC].peak_bytes);
+  if (untracked > 0)
+    printf ("%lld allocations not tracked: statistics table full\n",
+            untracked);
+}
+
+/* Prints allocation statistics at shutdown, if enabled. */
+void
+memstat_print_stats (void) 
+{
+  if (memstat_enabled)
+    memstat_dump ();
+}
+
+/* Returns the site for the allocator KIND called from CALLER,
+   creating it if necessary, or a null pointer if the site table
+   is full. */
+static struct memstat_site *
+find_site (enum memstat_kind kind, void *caller) 
+{
+  size_t start = live_hash (caller) % SITE_CNT;
+  size_t i = start;
+
+  do
+    {
+      struct memstat_site *s = &sites[i];
+      if (s->caller == NULL)
+        {
+          s->caller = caller;
+          s->kind = kind;
+          return s;
+        }
+      if (s->caller == caller && s->kind == kind)
+        return s;
+      i = (i + 1) % SITE_CNT;
+    }
+  while (i != start);
+  return NULL;
+}
+
+/* Returns the home slot of PTR in `lives'. */
+static size_t
+live_hash (const void *ptr) 
+{
+  /* Fibonacci hashing, keeping the high bits of the product. */
+  return ((uint32_t) (uintptr_t) ptr * 2654435769u) >> (32 - 12);
+}
+
+/* Returns the size class of a SIZE-byte request. */
+static int
+size_class (size_t size) 
+{
+  int k = 0;
+
+  while (k < CLASS_CNT - 1 && ((size_t) 1 << k) < size)
+    k++;
+  return k;
+}
+
+/* Charges an allocation of SIZE bytes to C. */
+static void
+count_alloc (struct memstat_counts *c, size_t size) 
+{
+  c->live_bytes += size;
+  if (c->live_bytes > c->peak_bytes)
+    c->peak_bytes = c->live_bytes;
+  c->live_cnt++;
+  c->alloc_cnt++;
+}
+
+/* Credits C with freeing SIZE bytes. */
+static void
+count_free (struct memstat_counts *c, size_t size) 
+{
+  c->live_bytes -= size;
+  c->live_cnt--;
+}
+
+/* Orders call sites by descending live bytes. */
+static int
+site_compare (const void *a_, const void *b_) 
+{
+  const struct memstat_site *a = *(const struct memstat_site **) a_;
+  const struct memstat_site *b = *(const struct memstat_site **) b_;
+
+  return ((a->counts.live_bytes < b->counts.live_bytes)
+          - (a->counts.live_bytes > b->counts.live_bytes));
+}
@@ -0,0 +1,26 @@
+#ifndef THREADS_MEMSTAT_H
+#define THREADS_MEMSTAT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Allocation accounting by call site.  If memstat_enabled is
+   true, which the kernel command-line option "-memstat" sets,
+   every malloc() and palloc allocation is tagged with the
+   address it was called from. */
+extern bool memstat_enabled;
+extern size_t memstat_top;
+
+/* Allocators, for distinguishing call sites. */
+enum memstat_kind
+  {
+    MEMSTAT_MALLOC,             /* malloc(), calloc(), realloc(). */
+    MEMSTAT_PALLOC              /* palloc_get_page(), palloc_get_multiple(). */
+  };
+
+void memstat_alloc (enum memstat_kind, void *, size_t size, void *caller);
+void memstat_free (void *);
+void memstat_dump (void);
+void memstat_print_stats (void);
+
+#endif /* threads/memstat.h */
@@ -2,13 +2,15 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/loader.h"
-#include "threads/synch.h"
+#include "threads/memstat.h"
+#include "threads/interrupt.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -23,14 +25,62 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is managed as a binary buddy system.  A free block of
+   order K is 2**K pages long and starts at a page index (relative
+   to the pool's base) that is a multiple of 2**K.  Free blocks
+   are kept on per-order lists threaded through the first page of
+   each block, so allocation and freeing take O(log n) list
+   operations.  A freed block is merged with its buddy, the other
+   half of the order K+1 block that contains it, whenever that
+   buddy is also wholly free.  A request for a number of pages
+   that is not a power of 2 takes the smallest block that fits
+   and returns the unused tail to the free lists at once.
+
+   Zeroing a page costs a 4 kB memset on the allocating thread's
+   critical path, so the idle thread takes free pages in small
+   bursts, zeroes them and sets them aside, up to ZERO_POOL_SIZE
+   per pool.  A single-page PAL_ZERO request takes one of those
+   first.  Pre-zeroed pages are off the free lists, so they are
+   given back whenever an allocation would otherwise fail.
+
+   Pages can be freed while a thread switch is in progress, so
+   the pools are protected by disabling interrupts rather than
+   by a lock. */
+
+/* Number of block orders.  Pools hold fewer than 2**PAL_ORDERS
+   pages. */
+#define PAL_ORDERS 20
+
+/* Marks a page that does not begin a free block. */
+#define NOT_FREE 0xff
+
+/* Maximum number of pre-zeroed pages kept per pool. */
+#define ZERO_POOL_SIZE 32
+
+/* Number of pages the idle thread zeroes at a time. */
+#define ZERO_BURST 4
 
 /* A memory pool. */
 struct pool
   {
-    struct lock lock;                   /* Mutual exclusion. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
+    uint8_t *orders;                    /* Order of free block at each page. */
+    struct list free_lists[PAL_ORDERS]; /* Free blocks, by order. */
     uint8_t *base;                      /* Base of pool. */
+    const char *name;                   /* Name, for statistics. */
+    void *zeroed[ZERO_POOL_SIZE];       /* Pre-zeroed pages. */
+    size_t zeroed_cnt;                  /* Number of pre-zeroed pages. */
+
+    /* Statistics. */
+    size_t free_cnt;                    /* Free pages. */
+    long long alloc_cnt;                /* Allocations. */
+    long long fail_cnt;                 /* Allocations that failed. */
+    long long split_cnt;                /* Blocks split in two. */
+    long long merge_cnt;                /* Buddies merged. */
+    long long zero_hits;                /* PAL_ZERO served pre-zeroed. */
+    long long zero_misses;              /* PAL_ZERO zeroed on demand. */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -39,6 +89,14 @@ static struct pool kernel_pool, user_pool;
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static void buddy_insert (struct pool *, size_t page_idx, int order);
+static void buddy_free_range (struct pool *, size_t page_idx,
+                              size_t page_cnt);
+static size_t buddy_alloc (struct pool *, size_t page_cnt);
+static void release_zeroed (struct pool *);
+static size_t zero_pages (struct pool *, size_t page_cnt);
+static void print_pool_stats (struct pool *);
+static void *get_pages (enum palloc_flags, size_t page_cnt, void *caller);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -69,17 +127,52 @@ palloc_init (size_t user_page_limit)
    FLAGS, in which case the kernel panics. */
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
+{
+  return get_pages (flags, page_cnt, __builtin_return_address (0));
+}
+
+/* Does the work of palloc_get_multiple(), charging the pages to
+   call site CALLER if allocation accounting is enabled. */
+static void *
+get_pages (enum palloc_flags flags, size_t page_cnt, void *caller)
 {
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
   void *pages;
   size_t page_idx;
+  bool zeroed = false;
+  enum intr_level old_level;
 
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
+  old_level = intr_disable ();
+  if ((flags & PAL_ZERO) && page_cnt == 1 && pool->zeroed_cnt > 0) 
+    {
+      pages = pool->zeroed[--pool->zeroed_cnt];
+      page_idx = pg_no (pages) - pg_no (pool->base);
+      zeroed = true;
+    }
+  else
+    {
+      page_idx = buddy_alloc (pool, page_cnt);
+      if (page_idx == BITMAP_ERROR && pool->zeroed_cnt > 0) 
+        {
+          release_zeroed (pool);
+          page_idx = buddy_alloc (pool, page_cnt);
+        }
+    }
+  if (page_idx != BITMAP_ERROR) 
+    {
+      bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+      pool->alloc_cnt++;
+      if (zeroed)
+        pool->zero_hits++;
+      else if (flags & PAL_ZERO)
+        pool->zero_misses++;
+    }
+  else
+    pool->fail_cnt++;
+  intr_set_level (old_level);
 
   if (page_idx != BITMAP_ERROR)
     pages = pool->base + PGSIZE * page_idx;
@@ -88,7 +181,7 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 
   if (pages != NULL) 
     {
-      if (flags & PAL_ZERO)
+      if ((flags & PAL_ZERO) && !zeroed)
         memset (pages, 0, PGSIZE * page_cnt);
     }
   else 
@@ -97,6 +190,10 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
         PANIC ("palloc_get: out of pages");
     }
 
+  /* malloc() accounts for its blocks itself.  Charging the pages
+     that hold them as well would count every byte twice. */
+  if (memstat_enabled && !(flags & PAL_NOSTAT))
+    memstat_alloc (MEMSTAT_PALLOC, pages, PGSIZE * page_cnt, caller);
   return pages;
 }
 
@@ -110,7 +207,7 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 void *
 palloc_get_page (enum palloc_flags flags) 
 {
-  return palloc_get_multiple (flags, 1);
+  return get_pages (flags, 1, __builtin_return_address (0));
 }
 
 /* Frees the PAGE_CNT pages starting at PAGES. */
@@ -119,6 +216,7 @@ palloc_free_multiple (void *pages, size_t page_cnt)
 {
   struct pool *pool;
   size_t page_idx;
+  enum intr_level old_level;
 
   ASSERT (pg_ofs (pages) == 0);
   if (pages == NULL || page_cnt == 0)
@@ -133,12 +231,18 @@ palloc_free_multiple (void *pages, size_t page_cnt)
 
   page_idx = pg_no (pages) - pg_no (pool->base);
 
+  if (memstat_enabled)
+    memstat_free (pages);
+
 #ifndef NDEBUG
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
+  old_level = intr_disable ();
   ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
   bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  buddy_free_range (pool, page_idx, page_cnt);
+  intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -148,25 +252,97 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Zeroes a few free pages for later PAL_ZERO requests, if
+   either pool is short of them.  Called by the idle thread with
+   interrupts on, so that the memsets do not delay interrupts. */
+void
+palloc_zero_idle (void) 
+{
+  size_t cnt = zero_pages (&kernel_pool, ZERO_BURST);
+  if (cnt < ZERO_BURST)
+    zero_pages (&user_pool, ZERO_BURST - cnt);
+}
+
+/* Moves up to PAGE_CNT pages from POOL's free lists to its
+   pre-zeroed pages, zeroing them along the way.  Returns the
+   number of pages moved. */
+static size_t
+zero_pages (struct pool *pool, size_t page_cnt) 
+{
+  size_t cnt;
+
+  for (cnt = 0; cnt < page_cnt; cnt++) 
+    {
+      size_t page_idx;
+      void *page;
+      enum intr_level old_level;
+
+      old_level = intr_disable ();
+      page_idx = pool->zeroed_cnt < ZERO_POOL_SIZE
+                 ? buddy_alloc (pool, 1) : BITMAP_ERROR;
+      intr_set_level (old_level);
+      if (page_idx == BITMAP_ERROR)
+        break;
+
+      /* Only the idle thread adds pre-zeroed pages, so there is
+         still room when we are done. */
+      page = pool->base + PGSIZE * page_idx;
+      memset (page, 0, PGSIZE);
+
+      old_level = intr_disable ();
+      ASSERT (pool->zeroed_cnt < ZERO_POOL_SIZE);
+      pool->zeroed[pool->zeroed_cnt++] = page;
+      intr_set_level (old_level);
+    }
+  return cnt;
+}
+
+/* Returns all of POOL's pre-zeroed pages to its free lists.
+   Interrupts must be off. */
+static void
+release_zeroed (struct pool *pool) 
+{
+  while (pool->zeroed_cnt > 0) 
+    {
+      void *page = pool->zeroed[--pool->zeroed_cnt];
+      buddy_free_range (pool, pg_no (page) - pg_no (pool->base), 1);
+    }
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
 init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
-  if (bm_pages > page_cnt)
+  /* We'll put the pool's used_map and block orders at its base.
+     Calculate the space needed for them and subtract it from the
+     pool's size. */
+  size_t bm_size = bitmap_buf_size (page_cnt);
+  size_t meta_pages = DIV_ROUND_UP (bm_size + page_cnt, PGSIZE);
+  int order;
+
+  if (meta_pages > page_cnt)
     PANIC ("Not enough memory in %s for bitmap.", name);
-  page_cnt -= bm_pages;
+  page_cnt -= meta_pages;
+  ASSERT (page_cnt < (size_t) 1 << PAL_ORDERS);
 
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
-  lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
-  p->base = base + bm_pages * PGSIZE;
+  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_size);
+  p->orders = (uint8_t *) base + bm_size;
+  memset (p->orders, NOT_FREE, page_cnt);
+  for (order = 0; order < PAL_ORDERS; order++)
+    list_init (&p->free_lists[order]);
+  p->base = base + meta_pages * PGSIZE;
+  p->name = name;
+  p->free_cnt = 0;
+  p->zeroed_cnt = 0;
+  p->alloc_cnt = p->fail_cnt = p->split_cnt = p->merge_cnt = 0;
+  p->zero_hits = p->zero_misses = 0;
+
+  /* Every page starts out free. */
+  buddy_free_range (p, 0, page_cnt);
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -180,3 +356,150 @@ page_from_pool (const struct pool *pool, void *page)
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* Returns the free list element stored in the first page of the
+   block at PAGE_IDX in POOL. */
+static struct list_elem *
+block_elem (const struct pool *pool, size_t page_idx) 
+{
+  return (struct list_elem *) (pool->base + PGSIZE * page_idx);
+}
+
+/* Returns the page index within POOL of the block whose free
+   list element is E. */
+static size_t
+elem_block (const struct pool *pool, struct list_elem *e) 
+{
+  return ((uint8_t *) e - pool->base) / PGSIZE;
+}
+
+/* Adds the free block of 2**ORDER pages at PAGE_IDX to POOL,
+   merging it with its buddy, and then the merged block with its
+   own buddy, and so on, for as long as the buddy is free. */
+static void
+buddy_insert (struct pool *pool, size_t page_idx, int order) 
+{
+  size_t page_cnt = bitmap_size (pool->used_map);
+
+  ASSERT (page_idx % ((size_t) 1 << order) == 0);
+
+  pool->free_cnt += (size_t) 1 << order;
+  for (; order < PAL_ORDERS - 1; order++)
+    {
+      size_t buddy = page_idx ^ ((size_t) 1 << order);
+      if (buddy >= page_cnt || pool->orders[buddy] != order)
+        break;
+      list_remove (block_elem (pool, buddy));
+      pool->orders[buddy] = NOT_FREE;
+      page_idx &= ~((size_t) 1 << order);
+      pool->merge_cnt++;
+    }
+
+  pool->orders[page_idx] = order;
+  list_push_front (&pool->free_lists[order], block_elem (pool, page_idx));
+}
+
+/* Returns the PAGE_CNT pages at PAGE_IDX in POOL to the free
+   lists, as the largest aligned blocks that cover them. */
+static void
+buddy_free_range (struct pool *pool, size_t page_idx, size_t page_cnt) 
+{
+  while (page_cnt > 0) 
+    {
+      int order = 0;
+      while (order < PAL_ORDERS - 1
+             && page_idx % ((size_t) 2 << order) == 0
+             && ((size_t) 2 << order) <= page_cnt)
+        order++;
+      buddy_insert (pool, page_idx, order);
+      page_idx += (size_t) 1 << order;
+      page_cnt -= (size_t) 1 << order;
+    }
+}
+
+/* Removes PAGE_CNT contiguous pages from POOL's free lists and
+   returns the page index of the first, or BITMAP_ERROR if no
+   free block is large enough. */
+static size_t
+buddy_alloc (struct pool *pool, size_t page_cnt) 
+{
+  size_t page_idx;
+  int order, want;
+
+  /* Find the smallest order that fits, then the smallest
+     nonempty free list at or above it. */
+  for (want = 0; want < PAL_ORDERS && ((size_t) 1 << want) < page_cnt;
+       want++)
+    continue;
+  for (order = want; order < PAL_ORDERS; order++)
+    if (!list_empty (&pool->free_lists[order]))
+      break;
+  if (order >= PAL_ORDERS)
+    return BITMAP_ERROR;
+
+  page_idx = elem_block (pool, list_pop_front (&pool->free_lists[order]));
+  pool->orders[page_idx] = NOT_FREE;
+  pool->free_cnt -= (size_t) 1 << order;
+
+  /* Split the block down to the order wanted, freeing the upper
+     halves.  Their buddies are in use, so they cannot merge. */
+  while (order > want) 
+    {
+      order--;
+      buddy_insert (pool, page_idx + ((size_t) 1 << order), order);
+      pool->split_cnt++;
+    }
+
+  /* Give back the tail that the request does not need. */
+  buddy_free_range (pool, page_idx + page_cnt,
+                    ((size_t) 1 << want) - page_cnt);
+  return page_idx;
+}
+
+/* Prints page allocator statistics. */
+void
+palloc_print_stats (void) 
+{
+  print_pool_stats (&kernel_pool);
+  print_pool_stats (&user_pool);
+}
+
+/* Prints statistics for POOL: its free pages, how they are
+   split into blocks, and how fragmented they are.  Fragmentation
+   is the percentage of free pages that lie outside the largest
+   free block, so 0% means all free memory is contiguous. */
+static void
+print_pool_stats (struct pool *pool) 
+{
+  size_t largest = 0;
+  int order;
+
+  printf ("Palloc %s: %zu of %zu pages free, %lld allocations "
+          "(%lld failed), %lld splits, %lld merges\n",
+          pool->name, pool->free_cnt, bitmap_size (pool->used_map),
+          pool->alloc_cnt, pool->fail_cnt,
+          pool->split_cnt, pool->merge_cnt);
+
+  printf ("  Free blocks by order:");
+  for (order = 0; order < PAL_ORDERS; order++) 
+    {
+      size_t cnt = list_size (&pool->free_lists[order]);
+      if (cnt > 0) 
+        {
+          printf (" %d:%zu", order, cnt);
+          largest = (size_t) 1 << order;
+        }
+    }
+  printf ("\n");
+
+  if (pool->free_cnt > 0)
+    printf ("  Largest free block %zu pages, %zu%% fragmented\n",
+            largest, (pool->free_cnt - largest) * 100 / pool->free_cnt);
+
+  if (pool->zero_hits + pool->zero_misses > 0)
+    printf ("  Pre-zeroed pages: %lld hits, %lld misses (%lld%% hit rate), "
+            "%zu ready\n",
+            pool->zero_hits, pool->zero_misses,
+            pool->zero_hits * 100 / (pool->zero_hits + pool->zero_misses),
+            pool->zeroed_cnt);
+}
@@ -8,7 +8,8 @@ enum palloc_flags
   {
     PAL_ASSERT = 001,           /* Panic on failure. */
     PAL_ZERO = 002,             /* Zero page contents. */
-    PAL_USER = 004              /* User page. */
+    PAL_USER = 004,             /* User page. */
+    PAL_NOSTAT = 010            /* Not charged to a call site (see memstat). */
   };
 
 void palloc_init (size_t user_page_limit);
@@ -16,5 +17,7 @@ void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
+void palloc_zero_idle (void);
+void palloc_print_stats (void);
 
 #endif /* threads/palloc.h */
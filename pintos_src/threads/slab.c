@@ -0,0 +1,254 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Slab allocator for fixed-size kernel objects, after Bonwick's
+   design.
+
+   malloc() rounds every request up to a power of 2, so an object
+   just over a power of 2 wastes nearly half its block, and all
+   blocks of a size class share one lock.  A kmem_cache instead
+   serves objects of exactly one size, packed into page-size
+   "slabs", each with its own free list and lock.
+
+   If a cache has a constructor, it is run once on each object
+   when its slab is created, not on every allocation.  Callers
+   must return objects to the cache in their constructed state,
+   so that state such as an initialized lock survives from one
+   allocation to the next.
+
+   Successive slabs start their objects at different "colour"
+   offsets, using the space left over at the end of a slab, so
+   that the same object in different slabs does not always land
+   on the same cache line. */
+
+/* Alignment of objects, and of colour offsets. */
+#define SLAB_ALIGN sizeof (void *)
+#define COLOUR_ALIGN 32
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* A slab, stored at the beginning of its page. */
+struct slab
+  {
+    unsigned magic;             /* Always set to SLAB_MAGIC. */
+    struct kmem_cache *cache;   /* Owning cache. */
+    struct list_elem elem;      /* Element in cache's `partial' list. */
+    size_t free_cnt;            /* Number of free objects. */
+    void *free;                 /* First free object. */
+  };
+
+/* All caches, for statistics. */
+static struct list all_caches;
+
+static struct slab *slab_create (struct kmem_cache *);
+static void **free_link (const struct kmem_cache *, void *obj);
+
+/* Initializes the slab allocator. */
+void
+kmem_init (void) 
+{
+  list_init (&all_caches);
+}
+
+/* Initializes CACHE to hand out objects of SIZE bytes, naming it
+   NAME for statistics.  If CTOR is nonnull, it is called on each
+   object when its slab is created. */
+void
+kmem_cache_init (struct kmem_cache *cache, const char *name, size_t size,
+                 kmem_ctor_func *ctor) 
+{
+  size_t space = PGSIZE - sizeof (struct slab);
+
+  ASSERT (cache != NULL);
+  ASSERT (size > 0);
+
+  /* A free object's link to the next free object overlays its
+     first bytes, unless a constructor has initialized them, in
+     which case it goes after the object. */
+  cache->name = name;
+  cache->obj_size = size;
+  if (ctor == NULL)
+    {
+      cache->link_ofs = 0;
+      cache->stride = ROUND_UP (size < sizeof (void *) ? sizeof (void *)
+                                : size, SLAB_ALIGN);
+    }
+  else
+    {
+      cache->link_ofs = ROUND_UP (size, SLAB_ALIGN);
+      cache->stride = cache->link_ofs + sizeof (void *);
+    }
+  ASSERT (cache->stride <= space);
+  cache->objs_per_slab = space / cache->stride;
+  cache->colour_cnt = (space - cache->objs_per_slab * cache->stride)
+                      / COLOUR_ALIGN + 1;
+  cache->next_colour = 0;
+  cache->ctor = ctor;
+  lock_init (&cache->lock);
+  list_init (&cache->partial);
+  cache->empty_cnt = 0;
+  cache->slab_cnt = cache->in_use = cache->peak = 0;
+  cache->alloc_cnt = cache->free_cnt = 0;
+  list_push_back (&all_caches, &cache->elem);
+}
+
+/* Obtains and returns an object from CACHE, or a null pointer if
+   memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *cache) 
+{
+  struct slab *s;
+  void *obj;
+
+  ASSERT (cache != NULL);
+
+  lock_acquire (&cache->lock);
+  if (list_empty (&cache->partial)) 
+    {
+      s = slab_create (cache);
+      if (s == NULL) 
+        {
+          lock_release (&cache->lock);
+          return NULL;
+        }
+      list_push_front (&cache->partial, &s->elem);
+    }
+  else
+    {
+      s = list_entry (list_front (&cache->partial), struct slab, elem);
+      if (s->free_cnt == cache->objs_per_slab)
+        cache->empty_cnt--;
+    }
+
+  /* Take the slab's first free object, and retire the slab from
+     the partial list once it is full. */
+  obj = s->free;
+  s->free = *free_link (cache, obj);
+  if (--s->free_cnt == 0)
+    list_remove (&s->elem);
+
+  cache->alloc_cnt++;
+  if (++cache->in_use > cache->peak)
+    cache->peak = cache->in_use;
+  lock_release (&cache->lock);
+
+  return obj;
+}
+
+/* Returns OBJ, which must have been obtained from CACHE, to
+   CACHE.  If OBJ's slab is left wholly free and CACHE already
+   has a free slab in reserve, the slab's page is released. */
+void
+kmem_cache_free (struct kmem_cache *cache, void *obj) 
+{
+  struct slab *s;
+
+  ASSERT (cache != NULL);
+  if (obj == NULL)
+    return;
+
+  s = pg_round_down (obj);
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT (s->cache == cache);
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs, unless
+     it must keep its constructed state. */
+  if (cache->ctor == NULL)
+    memset (obj, 0xcc, cache->obj_size);
+#endif
+
+  lock_acquire (&cache->lock);
+  *free_link (cache, obj) = s->free;
+  s->free = obj;
+  if (s->free_cnt++ == 0)
+    list_push_front (&cache->partial, &s->elem);
+
+  if (s->free_cnt == cache->objs_per_slab) 
+    {
+      if (cache->empty_cnt > 0) 
+        {
+          list_remove (&s->elem);
+          s->magic = 0;
+          palloc_free_page (s);
+          cache->slab_cnt--;
+        }
+      else
+        cache->empty_cnt++;
+    }
+
+  cache->free_cnt++;
+  cache->in_use--;
+  lock_release (&cache->lock);
+}
+
+/* Prints statistics for each cache.  Memory efficiency is the
+   share of the cache's slab pages occupied by objects in use. */
+void
+kmem_print_stats (void) 
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&all_caches); e != list_end (&all_caches);
+       e = list_next (e)) 
+    {
+      struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+      size_t bytes = c->slab_cnt * PGSIZE;
+
+      printf ("Slab %s: %zu-byte objects, %zu in use (peak %zu), "
+              "%zu slabs, %lld allocs, %lld frees, %zu%% efficient\n",
+              c->name, c->obj_size, c->in_use, c->peak, c->slab_cnt,
+              c->alloc_cnt, c->free_cnt,
+              bytes > 0 ? c->in_use * c->obj_size * 100 / bytes : 0);
+    }
+}
+
+/* Allocates and returns a new slab for CACHE with all of its
+   objects free and constructed, or a null pointer if memory is
+   not available.  The caller must hold CACHE's lock. */
+static struct slab *
+slab_create (struct kmem_cache *cache) 
+{
+  struct slab *s;
+  uint8_t *obj;
+  size_t i;
+
+  s = palloc_get_page (0);
+  if (s == NULL)
+    return NULL;
+
+  s->magic = SLAB_MAGIC;
+  s->cache = cache;
+  s->free_cnt = cache->objs_per_slab;
+  s->free = NULL;
+
+  /* Thread the objects onto the free list in reverse, so that
+     they are handed out in address order. */
+  obj = (uint8_t *) (s + 1) + cache->next_colour * COLOUR_ALIGN;
+  cache->next_colour = (cache->next_colour + 1) % cache->colour_cnt;
+  for (i = cache->objs_per_slab; i-- > 0; ) 
+    {
+      void *o = obj + i * cache->stride;
+      if (cache->ctor != NULL)
+        cache->ctor (o);
+      *free_link (cache, o) = s->free;
+      s->free = o;
+    }
+
+  cache->slab_cnt++;
+  return s;
+}
+
+/* Returns the location of OBJ's link to the next free object. */
+static void **
+free_link (const struct kmem_cache *cache, void *obj) 
+{
+  return (void **) ((uint8_t *) obj + cache->link_ofs);
+}
@@ -0,0 +1,42 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include "threads/synch.h"
+
+/* Constructs an object in a fresh slab. */
+typedef void kmem_ctor_func (void *obj);
+
+/* A cache of fixed-size objects.  See slab.c for details. */
+struct kmem_cache
+  {
+    const char *name;           /* Name, for statistics. */
+    size_t obj_size;            /* Object size as requested. */
+    size_t stride;              /* Bytes between objects in a slab. */
+    size_t link_ofs;            /* Offset of free link in an object. */
+    size_t objs_per_slab;       /* Number of objects in a slab. */
+    size_t colour_cnt;          /* Number of distinct colour offsets. */
+    size_t next_colour;         /* Colour of next slab created. */
+    kmem_ctor_func *ctor;       /* Constructor, or null. */
+    struct lock lock;           /* Protects the slab lists. */
+    struct list partial;        /* Slabs with at least one free object. */
+    size_t empty_cnt;           /* Wholly free slabs on `partial'. */
+    struct list_elem elem;      /* Element in list of all caches. */
+
+    /* Statistics. */
+    size_t slab_cnt;            /* Slabs allocated. */
+    size_t in_use;              /* Objects allocated. */
+    size_t peak;                /* Maximum of in_use. */
+    long long alloc_cnt;        /* Calls to kmem_cache_alloc(). */
+    long long free_cnt;         /* Calls to kmem_cache_free(). */
+  };
+
+void kmem_init (void);
+void kmem_cache_init (struct kmem_cache *, const char *name, size_t size,
+                      kmem_ctor_func *);
+void *kmem_cache_alloc (struct kmem_cache *);
+void kmem_cache_free (struct kmem_cache *, void *);
+void kmem_print_stats (void);
+
+#endif /* threads/slab.h */
@@ -28,10 +28,54 @@
 
 #include "threads/synch.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include "devices/timer.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 
+/* Maximum length of a chain of nested priority donations. */
+#define DONATION_DEPTH_MAX 8
+
+/* Contention statistics for the synchronization objects of one
+   kind initialized at one source location.
+
+   If lockstat_enabled is false, which is the default, objects
+   get a null `stat' pointer and testing it is the only cost.
+   Otherwise each object points to the record for its kind and
+   location, so that all the inodes' locks, say, add up in one
+   record.  Times are in timer ticks.  Semaphores and locks used
+   inside the other primitives are not counted separately. */
+struct lockstat
+  {
+    const char *kind;           /* "sema", "lock", "rwlock" or "cond". */
+    const char *file;           /* Source file of initialization. */
+    int line;                   /* Source line of initialization. */
+    long long acquired;         /* # of downs, acquires or waits. */
+    long long contended;        /* # of those that had to wait. */
+    long long total_wait;       /* Ticks spent waiting. */
+    long long max_wait;         /* Longest single wait. */
+    long long max_hold;         /* Longest hold (locks only). */
+  };
+
+/* If true, keep lock statistics.
+   Controlled by kernel command-line option "-lockstat". */
+bool lockstat_enabled;
+
+#define LOCKSTAT_CNT 256
+static struct lockstat lockstats[LOCKSTAT_CNT];
+static size_t lockstat_cnt;
+static long long lockstat_untracked;    /* # of objects that found no room. */
+
+static void lock_donate_priority (struct lock *);
+static void lock_update_max_priority (struct lock *);
+static rbtree_less_func sema_waiter_less;
+static rbtree_less_func cond_waiter_less;
+static struct lockstat *lockstat_register (const char *kind,
+                                           const char *file, int line);
+static void lockstat_record (struct lockstat *, bool contended,
+                             int64_t start);
+
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
    manipulating it:
@@ -40,14 +84,36 @@
      decrement it.
 
    - up or "V": increment the value (and wake up one waiting
-     thread, if any). */
+     thread, if any).
+
+   Waiting threads are kept in order of priority, and in order of
+   arrival among threads of equal priority, so that each "up"
+   wakes the first of the highest-priority waiters.
+
+   Called through the sema_init() macro, which supplies the
+   caller's FILE and LINE for lock statistics.  A null FILE
+   means not to keep statistics for SEMA. */
 void
-sema_init (struct semaphore *sema, unsigned value) 
+sema_init_at (struct semaphore *sema, unsigned value,
+              const char *file, int line) 
 {
   ASSERT (sema != NULL);
 
   sema->value = value;
-  list_init (&sema->waiters);
+  rbtree_init (&sema->waiters, sema_waiter_less, NULL);
+  sema->stat = lockstat_register ("sema", file, line);
+}
+
+/* Orders threads waiting on a semaphore by descending
+   priority. */
+static bool
+sema_waiter_less (const struct rbtree_elem *a_, const struct rbtree_elem *b_,
+                  void *aux UNUSED)
+{
+  const struct thread *a = rbtree_entry (a_, struct thread, tree_elem);
+  const struct thread *b = rbtree_entry (b_, struct thread, tree_elem);
+
+  return a->priority > b->priority;
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -61,17 +127,28 @@ void
 sema_down (struct semaphore *sema) 
 {
   enum intr_level old_level;
+  bool contended = false;
+  int64_t start = 0;
 
   ASSERT (sema != NULL);
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
+  if (sema->stat != NULL && sema->value == 0)
+    {
+      contended = true;
+      start = timer_ticks ();
+    }
   while (sema->value == 0) 
     {
-      list_push_back (&sema->waiters, &thread_current ()->elem);
+      struct thread *cur = thread_current ();
+      cur->waiting_sema = sema;
+      rbtree_insert (&sema->waiters, &cur->tree_elem);
       thread_block ();
     }
   sema->value--;
+  if (sema->stat != NULL)
+    lockstat_record (sema->stat, contended, start);
   intr_set_level (old_level);
 }
 
@@ -93,6 +170,8 @@ sema_try_down (struct semaphore *sema)
     {
       sema->value--;
       success = true; 
+      if (sema->stat != NULL)
+        lockstat_record (sema->stat, false, 0);
     }
   else
     success = false;
@@ -104,37 +183,54 @@ sema_try_down (struct semaphore *sema)
 /* Up or "V" operation on a semaphore.  Increments SEMA's value
    and wakes up one thread of those waiting for SEMA, if any.
 
+   The thread woken is the waiter with the highest priority as of
+   its last priority refresh.  Under the MLFQS, blocked threads
+   are refreshed lazily (see thread_catch_up() in thread.c), so a
+   waiter's priority may miss up to CATCH_UP_AGE seconds' worth
+   of recent_cpu decay, and a waiter whose priority has since
+   risen may be passed over for one refreshed more recently.
+
    This function may be called from an interrupt handler. */
 void
 sema_up (struct semaphore *sema) 
 {
-  struct thread *wake_up, *curr;
   enum intr_level old_level;
 
   ASSERT (sema != NULL);
 
-  /*ADDED*/
-  wake_up = NULL;
-  curr = thread_current ();
-  sort_thread_list (&sema->waiters);
- /*END*/
   old_level = intr_disable ();
+  if (!rbtree_empty (&sema->waiters)) 
+    {
+      struct rbtree_elem *e = rbtree_min (&sema->waiters);
+      struct thread *t = rbtree_entry (e, struct thread, tree_elem);
 
-  if (!list_empty (&sema->waiters)) 
-   {
-      wake_up = list_entry (list_pop_front (&sema->waiters), struct thread, elem);
-      thread_unblock (wake_up);
-   }
+      rbtree_remove (&sema->waiters, e);
+      t->waiting_sema = NULL;
+      thread_unblock (t);
+    }
   sema->value++;
   
-  /*ADDED*/
-  if (wake_up != NULL && wake_up->priority > curr->priority)
-    thread_yield_head (curr);
-  /*END*/
+  /* Let the woken thread run now if it outranks us. */
+  thread_preempt ();
   
   intr_set_level (old_level);
 }
 
+/* Sets the priority of T, which is waiting on SEMA, to PRIORITY
+   and moves T to its new place among SEMA's waiters, behind any
+   waiters of the same priority.  Interrupts must be off. */
+void
+sema_reprioritize (struct semaphore *sema, struct thread *t, int priority)
+{
+  ASSERT (sema != NULL);
+  ASSERT (t->waiting_sema == sema);
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  rbtree_remove (&sema->waiters, &t->tree_elem);
+  t->priority = priority;
+  rbtree_insert (&sema->waiters, &t->tree_elem);
+}
+
 static void sema_test_helper (void *sema_);
 
 /* Self-test for semaphores that makes control "ping-pong"
@@ -186,14 +282,20 @@ sema_test_helper (void *sema_)
    another one "up" it, but with a lock the same thread must both
    acquire and release it.  When these restrictions prove
    onerous, it's a good sign that a semaphore should be used,
-   instead of a lock. */
+   instead of a lock.
+
+   Called through the lock_init() macro, which supplies the
+   caller's FILE and LINE for lock statistics.  A null FILE
+   means not to keep statistics for LOCK. */
 void
-lock_init (struct lock *lock)
+lock_init_at (struct lock *lock, const char *file, int line)
 {
   ASSERT (lock != NULL);
 
   lock->holder = NULL;
-  sema_init (&lock->semaphore, 1);
+  sema_init_at (&lock->semaphore, 1, NULL, 0);
+  lock->max_priority = PRI_MIN;
+  lock->stat = lockstat_register ("lock", file, line);
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -211,8 +313,78 @@ lock_acquire (struct lock *lock)
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  bool contended = false;
+  int64_t start = 0;
+
+  old_level = intr_disable ();
+  if (lock->stat != NULL && lock->semaphore.value == 0)
+    {
+      contended = true;
+      start = timer_ticks ();
+    }
+  if (!thread_mlfqs && lock->holder != NULL)
+    {
+      cur->waiting_lock = lock;
+      lock_donate_priority (lock);
+    }
+
   sema_down (&lock->semaphore);
-  lock->holder = thread_current ();
+
+  cur->waiting_lock = NULL;
+  lock->holder = cur;
+  if (lock->stat != NULL)
+    {
+      lockstat_record (lock->stat, contended, start);
+      lock->acquired_at = timer_ticks ();
+    }
+  if (!thread_mlfqs)
+    {
+      /* The remaining waiters now donate to us. */
+      lock_update_max_priority (lock);
+      list_push_back (&cur->locks, &lock->elem);
+      thread_refresh_priority (cur);
+    }
+  intr_set_level (old_level);
+}
+
+/* Donates the running thread's priority to the holder of LOCK,
+   and on down the chain of locks that each holder is itself
+   waiting for, up to DONATION_DEPTH_MAX levels.  Interrupts must
+   be off. */
+static void
+lock_donate_priority (struct lock *lock)
+{
+  int priority = thread_current ()->priority;
+  int depth;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (depth = 0; depth < DONATION_DEPTH_MAX; depth++)
+    {
+      if (lock == NULL || lock->holder == NULL
+          || lock->max_priority >= priority)
+        break;
+      lock->max_priority = priority;
+      thread_refresh_priority (lock->holder);
+      lock = lock->holder->waiting_lock;
+    }
+}
+
+/* Recomputes the highest priority among LOCK's waiters.
+   Interrupts must be off. */
+static void
+lock_update_max_priority (struct lock *lock)
+{
+  struct rbtree_elem *e = rbtree_min (&lock->semaphore.waiters);
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (e != NULL)
+    lock->max_priority = rbtree_entry (e, struct thread, tree_elem)->priority;
+  else
+    lock->max_priority = PRI_MIN;
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -231,7 +403,22 @@ lock_try_acquire (struct lock *lock)
 
   success = sema_try_down (&lock->semaphore);
   if (success)
-    lock->holder = thread_current ();
+    {
+      enum intr_level old_level = intr_disable ();
+      lock->holder = thread_current ();
+      if (lock->stat != NULL)
+        {
+          lockstat_record (lock->stat, false, 0);
+          lock->acquired_at = timer_ticks ();
+        }
+      if (!thread_mlfqs)
+        {
+          lock_update_max_priority (lock);
+          list_push_back (&lock->holder->locks, &lock->elem);
+          thread_refresh_priority (lock->holder);
+        }
+      intr_set_level (old_level);
+    }
   return success;
 }
 
@@ -246,8 +433,22 @@ lock_release (struct lock *lock)
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
+  enum intr_level old_level = intr_disable ();
+  if (lock->stat != NULL)
+    {
+      int64_t hold = timer_ticks () - lock->acquired_at;
+      if (hold > lock->stat->max_hold)
+        lock->stat->max_hold = hold;
+    }
+  if (!thread_mlfqs)
+    {
+      /* Give back whatever was donated through LOCK. */
+      list_remove (&lock->elem);
+      thread_refresh_priority (lock->holder);
+    }
   lock->holder = NULL;
   sema_up (&lock->semaphore);
+  intr_set_level (old_level);
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -261,22 +462,200 @@ lock_held_by_current_thread (const struct lock *lock)
   return lock->holder == thread_current ();
 }
 
-/* One semaphore in a list. */
+/* Initializes RWLOCK.  A readers-writer lock may be held either
+   by any number of readers at once or by a single writer.
+
+   Writers are preferred: once a writer is waiting, threads that
+   ask for read access afterward wait until it is done.  This is
+   arranged by having the writer hold RWLOCK's `writer' lock from
+   the time it starts waiting until it releases write access,
+   and having each reader acquire `writer' briefly on its way in.
+   A writer that holds `writer' then waits only for the readers
+   already inside to leave.
+
+   Because `writer' is an ordinary lock, threads waiting for
+   access donate their priority to the writer ahead of them,
+   whenever lock priority donation is in effect.  There is no
+   donation to readers, since there may be many of them.
+
+   Neither kind of access is recursive: a thread must not acquire
+   read or write access to a readers-writer lock that it already
+   holds, in either mode.
+
+   Called through the rwlock_init() macro, which supplies the
+   caller's FILE and LINE for lock statistics.  These count
+   passes through `writer', so waits by readers and writers are
+   included, and holds by writers. */
+void
+rwlock_init_at (struct rwlock *rw, const char *file, int line)
+{
+  ASSERT (rw != NULL);
+
+  lock_init_at (&rw->writer, NULL, 0);
+  rw->writer.stat = lockstat_register ("rwlock", file, line);
+  rw->readers = 0;
+  rw->draining = false;
+  sema_init_at (&rw->drained, 0, NULL, 0);
+}
+
+/* Acquires read access to RW, sleeping until no writer holds or
+   is waiting for it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+
+  lock_acquire (&rw->writer);
+  old_level = intr_disable ();
+  rw->readers++;
+  intr_set_level (old_level);
+  lock_release (&rw->writer);
+}
+
+/* Tries to acquire read access to RW without sleeping.  Returns
+   true if successful, false if a writer holds or is waiting for
+   RW. */
+bool
+rwlock_try_acquire_read (struct rwlock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+
+  if (!lock_try_acquire (&rw->writer))
+    return false;
+  old_level = intr_disable ();
+  rw->readers++;
+  intr_set_level (old_level);
+  lock_release (&rw->writer);
+  return true;
+}
+
+/* Releases read access to RW, which the current thread must
+   hold.  Lets a waiting writer in if this was the last reader. */
+void
+rwlock_release_read (struct rwlock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+
+  old_level = intr_disable ();
+  ASSERT (rw->readers > 0);
+  if (--rw->readers == 0 && rw->draining)
+    {
+      rw->draining = false;
+      sema_up (&rw->drained);
+    }
+  intr_set_level (old_level);
+}
+
+/* Acquires write access to RW, sleeping until any other writer
+   and all readers have released it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+
+  lock_acquire (&rw->writer);
+  old_level = intr_disable ();
+  if (rw->readers > 0)
+    {
+      rw->draining = true;
+      sema_down (&rw->drained);
+    }
+  intr_set_level (old_level);
+}
+
+/* Tries to acquire write access to RW without sleeping.  Returns
+   true if successful, false if RW is held in either mode. */
+bool
+rwlock_try_acquire_write (struct rwlock *rw)
+{
+  bool success;
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+
+  if (!lock_try_acquire (&rw->writer))
+    return false;
+  old_level = intr_disable ();
+  success = rw->readers == 0;
+  intr_set_level (old_level);
+  if (!success)
+    lock_release (&rw->writer);
+  return success;
+}
+
+/* Releases write access to RW, which the current thread must
+   hold. */
+void
+rwlock_release_write (struct rwlock *rw)
+{
+  ASSERT (rwlock_held_for_write (rw));
+
+  lock_release (&rw->writer);
+}
+
+/* Returns true if the current thread holds write access to RW,
+   false otherwise. */
+bool
+rwlock_held_for_write (const struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  return lock_held_by_current_thread (&rw->writer) && rw->readers == 0;
+}
+
+/* One semaphore in a condition variable's waiters. */
 struct semaphore_elem 
   {
-    struct list_elem elem;              /* List element. */
+    struct rbtree_elem elem;            /* Tree element. */
     struct semaphore semaphore;         /* This semaphore. */
+    int priority;                       /* Waiter's priority when it waited. */
   };
 
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
-   code to receive the signal and act upon it. */
+   code to receive the signal and act upon it.
+
+   Like a semaphore's, COND's waiters are woken in order of
+   priority, and in order of arrival among equal priorities.  A
+   waiter is ranked by its priority at the time it began
+   waiting.
+
+   Called through the cond_init() macro, which supplies the
+   caller's FILE and LINE for lock statistics.  These count every
+   wait as contended. */
 void
-cond_init (struct condition *cond)
+cond_init_at (struct condition *cond, const char *file, int line)
 {
   ASSERT (cond != NULL);
 
-  list_init (&cond->waiters);
+  rbtree_init (&cond->waiters, cond_waiter_less, NULL);
+  cond->stat = lockstat_register ("cond", file, line);
+}
+
+/* Orders a condition variable's waiters by descending
+   priority. */
+static bool
+cond_waiter_less (const struct rbtree_elem *a, const struct rbtree_elem *b,
+                  void *aux UNUSED)
+{
+  return (rbtree_entry (a, struct semaphore_elem, elem)->priority
+          > rbtree_entry (b, struct semaphore_elem, elem)->priority);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -303,16 +682,26 @@ void
 cond_wait (struct condition *cond, struct lock *lock) 
 {
   struct semaphore_elem waiter;
+  int64_t start = 0;
 
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
   
-  sema_init (&waiter.semaphore, 0);
-  list_push_back (&cond->waiters, &waiter.elem);
+  sema_init_at (&waiter.semaphore, 0, NULL, 0);
+  waiter.priority = thread_current ()->priority;
+  rbtree_insert (&cond->waiters, &waiter.elem);
+  if (cond->stat != NULL)
+    start = timer_ticks ();
   lock_release (lock);
   sema_down (&waiter.semaphore);
+  if (cond->stat != NULL)
+    {
+      enum intr_level old_level = intr_disable ();
+      lockstat_record (cond->stat, true, start);
+      intr_set_level (old_level);
+    }
   lock_acquire (lock);
 }
 
@@ -331,9 +720,12 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED)
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
 
-  if (!list_empty (&cond->waiters)) 
-    sema_up (&list_entry (list_pop_front (&cond->waiters),
-                          struct semaphore_elem, elem)->semaphore);
+  if (!rbtree_empty (&cond->waiters)) 
+    {
+      struct rbtree_elem *e = rbtree_min (&cond->waiters);
+      rbtree_remove (&cond->waiters, e);
+      sema_up (&rbtree_entry (e, struct semaphore_elem, elem)->semaphore);
+    }
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -348,6 +740,101 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
 
-  while (!list_empty (&cond->waiters))
+  while (!rbtree_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+/* Returns the statistics record for objects of the given KIND
+   initialized at FILE and LINE, creating it if necessary.
+   Returns a null pointer if statistics are disabled, if FILE is
+   null, or if the table of records is full. */
+static struct lockstat *
+lockstat_register (const char *kind, const char *file, int line)
+{
+  struct lockstat *stat = NULL;
+  enum intr_level old_level;
+  size_t i;
+
+  if (!lockstat_enabled || file == NULL)
+    return NULL;
+
+  old_level = intr_disable ();
+  for (i = 0; i < lockstat_cnt; i++)
+    if (lockstats[i].line == line && lockstats[i].kind == kind
+        && !strcmp (lockstats[i].file, file))
+      {
+        stat = &lockstats[i];
+        break;
+      }
+  if (stat == NULL)
+    {
+      if (lockstat_cnt < LOCKSTAT_CNT)
+        {
+          stat = &lockstats[lockstat_cnt++];
+          stat->kind = kind;
+          stat->file = file;
+          stat->line = line;
+        }
+      else
+        lockstat_untracked++;
+    }
+  intr_set_level (old_level);
+
+  return stat;
+}
+
+/* Counts an acquisition in STAT.  If CONTENDED, the acquirer
+   started waiting at tick START.  Interrupts must be off. */
+static void
+lockstat_record (struct lockstat *stat, bool contended, int64_t start)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  stat->acquired++;
+  if (contended)
+    {
+      long long wait = timer_ticks () - start;
+      stat->contended++;
+      stat->total_wait += wait;
+      if (wait > stat->max_wait)
+        stat->max_wait = wait;
+    }
+}
+
+/* Orders pointers to statistics records by descending total
+   wait. */
+static int
+lockstat_compare (const void *a_, const void *b_)
+{
+  const struct lockstat *a = *(const struct lockstat **) a_;
+  const struct lockstat *b = *(const struct lockstat **) b_;
+
+  return (a->total_wait < b->total_wait) - (a->total_wait > b->total_wait);
+}
+
+/* Prints lock statistics, if enabled, sorted by total wait. */
+void
+synch_print_stats (void) 
+{
+  static const struct lockstat *sorted[LOCKSTAT_CNT];
+  size_t i;
+
+  if (!lockstat_enabled)
+    return;
+
+  for (i = 0; i < lockstat_cnt; i++)
+    sorted[i] = &lockstats[i];
+  qsort (sorted, lockstat_cnt, sizeof *sorted, lockstat_compare);
+
+  printf ("Lock statistics, by total wait in ticks:\n");
+  printf ("%-6s %10s %10s %8s %8s %8s  %s\n", "kind", "acquired",
+          "contended", "wait", "max-wait", "max-hold", "initialized at");
+  for (i = 0; i < lockstat_cnt; i++)
+    printf ("%-6s %10lld %10lld %8lld %8lld %8lld  %s:%d\n",
+            sorted[i]->kind, sorted[i]->acquired, sorted[i]->contended,
+            sorted[i]->total_wait, sorted[i]->max_wait, sorted[i]->max_hold,
+            sorted[i]->file, sorted[i]->line);
+  if (lockstat_untracked > 0)
+    printf ("%lld objects not tracked: statistics table full\n",
+            lockstat_untracked);
+}
@@ -2,19 +2,35 @@
 #define THREADS_SYNCH_H
 
 #include <list.h>
+#include <rbtree.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+struct thread;
+
+/* Contention statistics, kept per source location at which
+   synchronization objects are initialized if lockstat_enabled
+   is true.  The *_init() macros below pass that location along.
+   See synch.c. */
+struct lockstat;
+extern bool lockstat_enabled;
+void synch_print_stats (void);
 
 /* A counting semaphore. */
 struct semaphore 
   {
     unsigned value;             /* Current value. */
-    struct list waiters;        /* List of waiting threads. */
+    struct rbtree waiters;      /* Waiting threads, by priority. */
+    struct lockstat *stat;      /* Statistics, or null. */
   };
 
-void sema_init (struct semaphore *, unsigned value);
+#define sema_init(SEMA, VALUE) sema_init_at (SEMA, VALUE, __FILE__, __LINE__)
+void sema_init_at (struct semaphore *, unsigned value,
+                   const char *file, int line);
 void sema_down (struct semaphore *);
 bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
+void sema_reprioritize (struct semaphore *, struct thread *, int priority);
 void sema_self_test (void);
 
 /* Lock. */
@@ -22,21 +38,47 @@ struct lock
   {
     struct thread *holder;      /* Thread holding lock (for debugging). */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
+    struct list_elem elem;      /* Element in holder's list of locks. */
+    int max_priority;           /* Highest priority donated by a waiter. */
+    struct lockstat *stat;      /* Statistics, or null. */
+    int64_t acquired_at;        /* Tick of acquisition, if STAT. */
   };
 
-void lock_init (struct lock *);
+#define lock_init(LOCK) lock_init_at (LOCK, __FILE__, __LINE__)
+void lock_init_at (struct lock *, const char *file, int line);
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
 
+/* Readers-writer lock. */
+struct rwlock 
+  {
+    struct lock writer;         /* Held by the writer, briefly by readers. */
+    unsigned readers;           /* # of threads holding read access. */
+    bool draining;              /* Writer is waiting for readers to leave. */
+    struct semaphore drained;   /* Upped when the last reader leaves. */
+  };
+
+#define rwlock_init(RW) rwlock_init_at (RW, __FILE__, __LINE__)
+void rwlock_init_at (struct rwlock *, const char *file, int line);
+void rwlock_acquire_read (struct rwlock *);
+bool rwlock_try_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+bool rwlock_try_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_for_write (const struct rwlock *);
+
 /* Condition variable. */
 struct condition 
   {
-    struct list waiters;        /* List of waiting threads. */
+    struct rbtree waiters;      /* Waiters, by priority. */
+    struct lockstat *stat;      /* Statistics, or null. */
   };
 
-void cond_init (struct condition *);
+#define cond_init(COND) cond_init_at (COND, __FILE__, __LINE__)
+void cond_init_at (struct condition *, const char *file, int line);
 void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
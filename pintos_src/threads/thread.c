@@ -2,7 +2,9 @@
 #include "threads/fixed-point.h"
 #include <debug.h>
 #include <stddef.h>
+#include <limits.h>
 #include <random.h>
+#include <rbtree.h>
 #include <stdio.h>
 #include <string.h>
 #include <filesys/file.h>
@@ -14,6 +16,7 @@
 #include "threads/synch.h"
 #include "devices/timer.h"
 #include "threads/vaddr.h"
+#include <round.h>
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
@@ -23,20 +26,65 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Number of distinct thread priorities. */
+#define PRI_CNT (PRI_MAX - PRI_MIN + 1)
+
+/* Run queue of processes in THREAD_READY state, that is,
+   processes that are ready to run but not actually running.
+   There is one FIFO list per priority level.  Bit P of
+   ready_bitmap is set if and only if ready_queues[P] is
+   non-empty, so the highest ready priority is found with a
+   single bit scan instead of keeping one sorted list.
+
+   Under the completely fair scheduler the priority queues are
+   unused.  Ready threads are kept instead in `cfs_tree', ordered
+   by virtual runtime, and the leftmost thread runs next.
+
+   Ready real-time threads are kept apart in `edf_tree', ordered
+   by deadline, and always run before any other thread. */
+static struct list ready_queues[PRI_CNT];
+static uint64_t ready_bitmap;
+static size_t ready_cnt;        /* # of ready threads, in all queues. */
+static struct rbtree cfs_tree;  /* Ready threads, by vruntime (CFS). */
+static uint32_t cfs_load;       /* Sum of weights in cfs_tree. */
+static int64_t min_vruntime;    /* Monotonic vruntime floor (CFS). */
+static struct rbtree edf_tree;  /* Ready EDF threads, by deadline. */
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
 static struct list all_list;
 
-/* List of processes in sleep (wait) state (i.e. wait queue). */
-static struct list wait_elem_list;
-
 /* Idle thread. */
 static struct thread *idle_thread;
 
+/* Index of all_list by tid, for get_thread_elem().  A thread is
+   added to bucket TID % TID_BUCKETS when it is given its tid.
+   tids are handed out in order, so live threads spread evenly
+   over the buckets.  The bucket count is fixed so that adding
+   and removing threads never allocates memory, which thread_exit()
+   could not do.  Protected by disabling interrupts, like
+   all_list. */
+#define TID_BUCKETS 256
+static struct list tid_index[TID_BUCKETS];
+
+/* Pages of threads that have died, kept for reuse by
+   thread_create() so that process churn does not go through the
+   page allocator and clear a whole page each time.  Only the
+   struct thread and the initial stack frames of a recycled page
+   are reinitialized.  Protected by disabling interrupts. */
+#define PAGE_CACHE_SIZE 16
+static struct thread *page_cache[PAGE_CACHE_SIZE];
+static size_t page_cache_cnt;
+
+/* Statistics. */
+static long long idle_ticks;    /* # of timer ticks spent idle. */
+static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
+static long long user_ticks;    /* # of timer ticks in user programs. */
+static long long edf_jobs;      /* # of EDF jobs completed. */
+static long long edf_misses;    /* # of EDF deadlines missed. */
+static long long pages_recycled;    /* # of thread pages taken from cache. */
+static long long pages_allocated;   /* # of thread pages from palloc. */
+
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
 
@@ -51,11 +99,6 @@ struct kernel_thread_frame
     void *aux;                  /* Auxiliary data for function. */
   };
 
-/* Statistics. */
-static long long idle_ticks;    /* # of timer ticks spent idle. */
-static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
-static long long user_ticks;    /* # of timer ticks in user programs. */
-
 /* Scheduling. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
 static unsigned thread_ticks;   /* # of timer ticks since last yield. */
@@ -65,6 +108,65 @@ static unsigned thread_ticks;   /* # of timer ticks since last yield. */
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler.
+   Controlled by kernel command-line option "-cfs". */
+bool thread_cfs;
+
+/* Completely fair scheduler.
+
+   Each thread accumulates virtual runtime as it runs, at a rate
+   inversely proportional to its weight, which is derived from
+   its nice value.  A nice-0 thread is charged CFS_TICK per timer
+   tick; each step of nice changes the weight by about 25%, as in
+   Linux.  The ready thread with the least vruntime runs next.
+
+   A running thread is preempted from thread_tick() once it has
+   run for its share of the scheduling period, which is
+   CFS_LATENCY ticks or CFS_MIN_GRANULARITY ticks per runnable
+   thread if that is longer, and a ready thread has fallen behind
+   it.  A thread that wakes up preempts the running thread if it
+   is more than CFS_WAKEUP_GRANULARITY behind.  A waking thread's
+   vruntime is raised to no less than half a period below
+   min_vruntime, so that sleeping does not bank credit. */
+#define CFS_WEIGHT_NICE_0 1024
+#define CFS_TICK ((int64_t) CFS_WEIGHT_NICE_0 << 10)
+#define CFS_LATENCY 8           /* Target scheduling period, in ticks. */
+#define CFS_MIN_GRANULARITY 1   /* Minimum time slice, in ticks. */
+#define CFS_WAKEUP_GRANULARITY CFS_TICK
+
+/* Earliest-deadline-first real-time class.
+
+   A thread created with thread_create_deadline() runs one job
+   per period and may use up to its budget of CPU time in each
+   job.  Such threads preempt every other thread, and among
+   themselves the one with the earliest deadline, the end of its
+   current period, runs first.  A job ends when the thread calls
+   thread_wait_next_period().
+
+   EDF meets every deadline as long as the total utilization,
+   the sum of budget / period, is at most 1, so
+   thread_create_deadline() admits a thread only if it fits.
+   Utilizations are kept in units of 1 / EDF_UTIL_SCALE, rounded
+   up.  A thread that exhausts its budget is suspended until its
+   next period, which keeps an overrunning thread from breaking
+   the guarantee for the others. */
+#define EDF_UTIL_SCALE 65536
+static uint32_t edf_utilization;        /* Sum of admitted utilizations. */
+
+/* Weight for each nice value from NICE_MIN to NICE_MAX. */
+static const uint32_t cfs_weights[NICE_MAX - NICE_MIN + 1] =
+  {
+    /* -20 */ 88761, 71755, 56483, 46273, 36291,
+    /* -15 */ 29154, 23254, 18705, 14949, 11916,
+    /* -10 */  9548,  7620,  6100,  4904,  3906,
+    /*  -5 */  3121,  2501,  1991,  1586,  1277,
+    /*   0 */  1024,   820,   655,   526,   423,
+    /*   5 */   335,   272,   215,   172,   137,
+    /*  10 */   110,    87,    70,    56,    45,
+    /*  15 */    36,    29,    23,    18,    15,
+    /*  20 */    12,
+  };
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
@@ -76,14 +178,67 @@ static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
-void thread_wake_up (int64_t current_tick);
-static bool thread_sort_desc (const struct list_elem *left, const struct list_elem *right, void *aux UNUSED);
-static bool thread_insert_desc_begin (const struct list_elem *left, const struct list_elem *right, void *aux UNUSED);
-static bool thread_insert_desc_end (const struct list_elem *left, const struct list_elem *right, void *aux UNUSED);
+static struct thread *alloc_thread_page (void);
+static void free_thread_page (struct thread *);
+static void tid_index_insert (struct thread *);
 static void thread_update_priority_for_one (struct thread *curr);
-static void thread_update_recent_cpu_for_one (struct thread *curr);
+static void thread_update_recent_cpu_for_one (struct thread *curr, int avg);
+static void thread_update_runnable (void (*func) (struct thread *));
+static void thread_decay_runnable (struct thread *);
+static void thread_catch_up (struct thread *);
+static void thread_catch_up_blocked (int64_t age, int max_cnt);
+static void ready_queue_insert (struct thread *, bool at_front);
+static void ready_queue_remove (struct thread *);
+static struct thread *ready_queue_pop (void);
+static int ready_queue_max_priority (void);
+static uint32_t cfs_weight (const struct thread *);
+static bool cfs_less (const struct rbtree_elem *, const struct rbtree_elem *,
+                      void *aux);
+static bool cfs_ready_before (int64_t vruntime);
+static void cfs_update_min_vruntime (void);
+static bool cfs_tick (struct thread *);
+static tid_t create_thread (const char *name, int priority,
+                            int64_t period, int64_t budget,
+                            thread_func *, void *aux);
+static uint32_t edf_util (int64_t period, int64_t budget);
+static bool edf_less (const struct rbtree_elem *, const struct rbtree_elem *,
+                      void *aux);
+static bool edf_ready_before (const struct thread *);
+static int64_t edf_next_job (struct thread *);
+static void edf_throttle (struct thread *);
 static int load_avg;
 
+/* Under the MLFQS, recent_cpu decays once per second by a factor
+   that depends on the load average at that second.  Only
+   runnable threads are decayed eagerly.  A blocked thread is
+   decayed lazily, when it is unblocked, by replaying the decays
+   it missed from load_history[], which holds the load average of
+   each of the last LOAD_HISTORY seconds.  Replaying the same
+   fixed-point steps keeps the results bit-for-bit identical to
+   decaying every thread every second.
+
+   Blocked threads sit on blocked_list in the order they blocked,
+   which is also the order of their `cpu_epoch', so the stalest
+   are found at its front.  So that none outlives the history,
+   every priority refresh catches up at most CATCH_UP_BATCH of
+   those that are CATCH_UP_AGE or more seconds behind.  This
+   spreads the work for threads that blocked together over many
+   ticks, long before their history runs out. */
+#define LOAD_HISTORY 64
+#define CATCH_UP_AGE (LOAD_HISTORY / 2)
+#define CATCH_UP_BATCH 8
+static int load_history[LOAD_HISTORY];
+static int64_t decay_epoch;     /* # of per-second decays so far. */
+static struct list blocked_list;
+
+/* Likewise, priorities are only refreshed for runnable threads.
+   prio_seq counts the refreshes and prio_epoch is the value of
+   decay_epoch at the latest one, so that a thread that missed a
+   refresh while blocked can recompute the priority it would
+   have been given. */
+static unsigned prio_seq;
+static int64_t prio_epoch;
+
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
    general and it is possible in this case only because loader.S
@@ -98,62 +253,39 @@ static int load_avg;
    It is not safe to call thread_current() until this function
    finishes. */
 
-static thread_func timer_wakeup;
-static struct thread* wakeup_thread;  /*Thread which is used for waking up sleeping threads*/
-
 void
 thread_init (void) 
 {
+  int i;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
   lock_init (&tid_lock);
-  list_init (&ready_list);
-  list_init (&wait_elem_list);
+  for (i = 0; i < PRI_CNT; i++)
+    list_init (&ready_queues[i]);
+  ready_bitmap = 0;
+  ready_cnt = 0;
+  rbtree_init (&cfs_tree, cfs_less, NULL);
+  rbtree_init (&edf_tree, edf_less, NULL);
+  cfs_load = 0;
+  min_vruntime = 0;
+  list_init (&blocked_list);
   list_init (&all_list);
+  for (i = 0; i < TID_BUCKETS; i++)
+    list_init (&tid_index[i]);
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
   init_thread (initial_thread, "main", PRI_DEFAULT);
   initial_thread->status = THREAD_RUNNING;
   initial_thread->tid = allocate_tid ();
+  tid_index_insert (initial_thread);
   initial_thread->sleep_endtick = 0;
 
   load_avg = 0;
 }
 
 
-static void timer_wakeup (void *param)
-{
-  //printf("\nWAKEUP");
-  wakeup_thread = thread_current();
-  while (true)
-  { 
-    enum intr_level old_level;
-    old_level = intr_disable();
-    thread_block();
-    intr_set_level(old_level);
-    int64_t current_tick = timer_ticks();
-    struct list_elem *e;
-    //printf("\nHELLO");
-
-	 // enumerate all threads in wait queue
-	 for (e = list_begin (&wait_elem_list); e != list_end (&wait_elem_list); e = list_next (e))
-	 {
-	      struct thread *t = list_entry (e, struct thread, wait_elem);
-	      //if wake up time(sleep_endtick) has arrived
-	      if (t->sleep_endtick <= current_tick)
-	       {
-	          // need not sleep(wait) anymore
-	          t->sleep_endtick = 0;
-	          //remove this thread from the wait queue
-	          list_remove (&t->wait_elem);
-	          // Add to run queue(state transition from sleep to run)
-	          thread_unblock (t);
-	       }
-	 }
-   }
-} 
-
 /* Starts preemptive thread scheduling by enabling interrupts.
    Also creates the idle thread. */
 void
@@ -161,10 +293,10 @@ thread_start (void)
 {
   /* Create the idle thread. */
   struct semaphore idle_started;
+
   sema_init (&idle_started, 0);
   thread_create ("idle", PRI_MIN, idle, &idle_started);
 
-  thread_create ("wakeup", PRI_MAX, timer_wakeup, NULL);
   /* Start preemptive thread scheduling. */
   intr_enable ();
 
@@ -175,7 +307,7 @@ thread_start (void)
 /* Called by the timer interrupt handler at each timer tick.
    Thus, this function runs in an external interrupt context. */
 void
-thread_tick (int64_t tick) 
+thread_tick (void) 
 {
   struct thread *t = thread_current ();
 
@@ -189,23 +321,32 @@ thread_tick (int64_t tick)
   else
     kernel_ticks++;
 
-  /*Unblock wakeup_thread if its time for some thread to wakeup */
-
-  if(!list_empty(&wait_elem_list))
-  {
-    struct list_elem* first = list_front(&wait_elem_list);
-    struct thread* cur = list_entry(first,struct thread,elem);
-    if(cur->sleep_endtick <= tick && wakeup_thread->status == THREAD_BLOCKED)
+  /* Enforce preemption. */
+  ++thread_ticks;
+  if (t->edf_period != 0)
     {
-      // printf("\n!!");
-      thread_unblock(wakeup_thread);
+      if (--t->edf_remaining <= 0)
+        {
+          t->edf_throttled = true;
+          intr_yield_on_return ();
+        }
     }
-  }
-
-  /* Enforce preemption. */
-  if (++thread_ticks >= TIME_SLICE)
+  else if (thread_cfs)
+    {
+      if (t != idle_thread && cfs_tick (t))
+        intr_yield_on_return ();
+    }
+  else if (thread_ticks >= TIME_SLICE)
     intr_yield_on_return ();
+}
 
+/* Called by the timer interrupt handler for each tick that the
+   CPU spent halted in tickless idle without taking an interrupt
+   for it. */
+void
+thread_tick_idle (void)
+{
+  idle_ticks++;
 }
 
 
@@ -215,6 +356,12 @@ thread_print_stats (void)
 {
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+  if (edf_jobs != 0 || edf_misses != 0)
+    printf ("EDF: %lld jobs completed, %lld deadline misses\n",
+            edf_jobs, edf_misses);
+  if (pages_recycled != 0)
+    printf ("Thread pages: %lld recycled, %lld allocated\n",
+            pages_recycled, pages_allocated);
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -235,6 +382,95 @@ thread_print_stats (void)
 tid_t
 thread_create (const char *name, int priority,
                thread_func *function, void *aux) 
+{
+  return create_thread (name, priority, 0, 0, function, aux);
+}
+
+/* Creates a new kernel thread named NAME in the earliest-deadline-
+   first real-time class, which executes FUNCTION passing AUX as
+   the argument.  The thread runs a job every PERIOD timer ticks
+   and may use up to BUDGET ticks of CPU time in each job; each
+   job's deadline is the end of its period.  FUNCTION should call
+   thread_wait_next_period() at the end of each job.
+
+   Returns the thread identifier for the new thread, or TID_ERROR
+   if creation fails or if admitting the thread would make the
+   total EDF utilization exceed 1.  The new
+   thread preempts the running thread unless that is an EDF
+   thread with an earlier deadline. */
+tid_t
+thread_create_deadline (const char *name, int64_t period, int64_t budget,
+                        thread_func *function, void *aux)
+{
+  uint32_t util;
+  enum intr_level old_level;
+  tid_t tid;
+
+  ASSERT (period > 0);
+  ASSERT (budget > 0 && budget <= period);
+
+  /* Admission control. */
+  util = edf_util (period, budget);
+  old_level = intr_disable ();
+  if (edf_utilization + util > EDF_UTIL_SCALE)
+    {
+      intr_set_level (old_level);
+      return TID_ERROR;
+    }
+  edf_utilization += util;
+  intr_set_level (old_level);
+
+  tid = create_thread (name, PRI_MAX, period, budget, function, aux);
+  if (tid == TID_ERROR)
+    {
+      old_level = intr_disable ();
+      edf_utilization -= util;
+      intr_set_level (old_level);
+    }
+  return tid;
+}
+
+/* Ends the running EDF thread's current job and sleeps until the
+   start of its next period.  A job that ends after its deadline
+   counts as a deadline miss, and periods that have already gone
+   by are skipped. */
+void
+thread_wait_next_period (void)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (cur->edf_period != 0);
+  ASSERT (!intr_context ());
+
+  old_level = intr_disable ();
+  edf_jobs++;
+  if (timer_ticks () > cur->edf_deadline)
+    edf_misses++;
+  if (timer_add (cur, edf_next_job (cur)))
+    thread_block ();
+  intr_set_level (old_level);
+}
+
+/* Returns the number of EDF deadlines missed so far, counting
+   both jobs that ended late and jobs that ran out of budget. */
+long long
+thread_get_edf_misses (void)
+{
+  enum intr_level old_level;
+  long long misses;
+
+  old_level = intr_disable ();
+  misses = edf_misses;
+  intr_set_level (old_level);
+  return misses;
+}
+
+/* Creates a thread for thread_create() or, if PERIOD is nonzero,
+   thread_create_deadline(). */
+static tid_t
+create_thread (const char *name, int priority, int64_t period,
+               int64_t budget, thread_func *function, void *aux)
 {
   struct thread *t;
   struct kernel_thread_frame *kf;
@@ -249,13 +485,21 @@ thread_create (const char *name, int priority,
   ASSERT (priority >= PRI_MIN && priority <= PRI_MAX);
 
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = alloc_thread_page ();
   if (t == NULL)
     return TID_ERROR;
 
   /* Initialize thread. */
   init_thread (t, name, priority);
   tid = t->tid = allocate_tid ();
+  tid_index_insert (t);
+  if (period != 0)
+    {
+      t->edf_period = period;
+      t->edf_budget = budget;
+      t->edf_remaining = budget;
+      t->edf_deadline = timer_ticks () + period;
+    }
 
   /* Prepare thread for first run by initializing its stack.
      Do this atomically so intermediate values for the 'stack' 
@@ -284,9 +528,15 @@ thread_create (const char *name, int priority,
 
   /* mlfqs scheduling when thread_mlfqs is set to true*/
   if (thread_mlfqs)
-    thread_update_priority_for_one (t);
+    {
+      old_level = intr_disable ();
+      thread_update_priority_for_one (t);
+      intr_set_level (old_level);
+    }
 
-  if (priority > thread_current ()->priority)
+  if (thread_cfs || period != 0)
+    thread_preempt ();
+  else if (priority > thread_current ()->priority)
     thread_yield();
 
   #ifdef USERPROG
@@ -303,35 +553,6 @@ thread_create (const char *name, int priority,
   return tid;
 }
 
-static bool 
-thread_comp(const struct list_elem * e1, const struct list_elem * e2, void * aux UNUSED)
-{
-  struct thread * t1 = list_entry(e1, struct thread, elem);
-  struct thread * t2 = list_entry(e2, struct thread, elem);
-  if (t1->sleep_endtick < t2->sleep_endtick)
-  {
-    return true;
-  }
-  return false;
-}
-
-//Sleep current thread till 'ticks_end' time
-void
-thread_sleep_till (int64_t endticks)
-{
-  //Get the current thread
-  struct thread *curr_thread = thread_current();
-
-  //Set the sleep_endtick to the parameter that is passed
-  curr_thread->sleep_endtick = endticks;
-
-  // put T into the wait queue
-  list_insert_ordered(&wait_elem_list, &curr_thread->wait_elem, thread_comp, NULL);
-
-  // make the current thread block (sleeped)
-  thread_block();
-}
-
 /* Puts the current thread to sleep.  It will not be scheduled
    again until awoken by thread_unblock().
 
@@ -341,10 +562,18 @@ thread_sleep_till (int64_t endticks)
 void
 thread_block (void) 
 {
+  struct thread *cur = thread_current ();
+
   ASSERT (!intr_context ());
   ASSERT (intr_get_level () == INTR_OFF);
 
-  thread_current ()->status = THREAD_BLOCKED;
+  cur->status = THREAD_BLOCKED;
+  if (thread_mlfqs && cur != idle_thread)
+    {
+      ASSERT (cur->cpu_epoch == decay_epoch);
+      cur->prio_seq = prio_seq;
+      list_push_back (&blocked_list, &cur->blocked_elem);
+    }
   schedule ();
 }
 
@@ -360,11 +589,22 @@ void
 thread_unblock (struct thread *t) 
 {
   enum intr_level old_level;
+
   ASSERT (is_thread (t));
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  /*list_push_back (&ready_list, &t->elem);*/
-  list_insert_ordered (&ready_list, &t->elem, thread_insert_desc_end, NULL);
+  if (thread_mlfqs)
+    {
+      list_remove (&t->blocked_elem);
+      thread_catch_up (t);
+    }
+  if (thread_cfs && t->edf_period == 0)
+    {
+      int64_t floor = min_vruntime - CFS_LATENCY * CFS_TICK / 2;
+      if (t->vruntime < floor)
+        t->vruntime = floor;
+    }
+  ready_queue_insert (t, false);
   t->status = THREAD_READY;
   intr_set_level (old_level);
 }
@@ -430,6 +670,10 @@ thread_exit (void)
      and schedule anfor_one process.  That process will destroy us
      when it calls thread_schedule_tail(). */
   intr_disable ();
+  if (thread_current ()->edf_period != 0)
+    edf_utilization -= edf_util (thread_current ()->edf_period,
+                                 thread_current ()->edf_budget);
+  list_remove (&thread_current ()->tid_elem);
   list_remove (&thread_current()->allelem);
   thread_current()->status = THREAD_DYING;
   schedule ();
@@ -442,18 +686,19 @@ void
 thread_yield (void) 
 {
   struct thread *cur = thread_current ();
-
-  if(cur == wakeup_thread) return;
-
   enum intr_level old_level;
   
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
+  if (cur->edf_throttled)
+    {
+      edf_throttle (cur);
+      intr_set_level (old_level);
+      return;
+    }
   if (cur != idle_thread) 
-  {
-     list_insert_ordered (&ready_list, &cur->elem, thread_insert_desc_end, NULL);
-  }
+    ready_queue_insert (cur, false);
   cur->status = THREAD_READY;
   schedule ();
   intr_set_level (old_level);
@@ -464,15 +709,11 @@ thread_yield_head (struct thread *cur)
 {
   enum intr_level old_level;
 
-  if(cur == wakeup_thread) return;
-  
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
   if (cur != idle_thread)
-  {
-    list_insert_ordered (&ready_list, &cur->elem, thread_insert_desc_begin, NULL);
-  }
+    ready_queue_insert (cur, true);
   cur->status = THREAD_READY;
   schedule ();
   intr_set_level (old_level);
@@ -499,17 +740,87 @@ thread_foreach (thread_action_func *func, void *aux)
 void
 thread_set_priority (int new_priority) 
 {
-  //thread_current ()->priority = new_priority;
-  struct thread* curr = thread_current();
-  curr->priority = new_priority;
-  
-  if (curr->status == THREAD_READY) /* Re-order the ready-list */
+  struct thread *curr = thread_current ();
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  curr->base_priority = new_priority;
+  thread_refresh_priority (curr);
+  intr_set_level (old_level);
+
+  thread_preempt ();
+}
+
+/* Recomputes T's effective priority as the larger of its base
+   priority and the highest priority donated through any lock it
+   holds, moving T to its new place in its run queue if it is
+   ready or among a semaphore's waiters if it is waiting on one.
+   Interrupts must be off. */
+void
+thread_refresh_priority (struct thread *t)
+{
+  struct list_elem *e;
+  int priority;
+
+  ASSERT (is_thread (t));
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  priority = t->base_priority;
+  for (e = list_begin (&t->locks); e != list_end (&t->locks);
+       e = list_next (e))
     {
-      list_remove (&curr->elem);
-      list_insert_ordered (&ready_list, &curr->elem, thread_insert_desc_end, NULL);
+      struct lock *l = list_entry (e, struct lock, elem);
+      if (l->max_priority > priority)
+        priority = l->max_priority;
     }
-  else if (curr->status == THREAD_RUNNING && list_entry (list_begin (&ready_list), struct thread, elem)->priority > new_priority)
-    thread_yield_head (curr);
+
+  if (priority == t->priority)
+    return;
+  if (t->status == THREAD_READY)
+    {
+      ready_queue_remove (t);
+      t->priority = priority;
+      ready_queue_insert (t, false);
+    }
+  else if (t->status == THREAD_BLOCKED && t->waiting_sema != NULL)
+    sema_reprioritize (t->waiting_sema, t, priority);
+  else
+    t->priority = priority;
+}
+
+/* Yields the CPU if a ready EDF thread has an earlier deadline
+   than the running thread, which every non-EDF thread counts as
+   having.  Otherwise, unless the running thread is an EDF
+   thread, yields if a ready thread has a higher priority, or
+   under the CFS, if a ready thread's vruntime is behind the
+   running thread's by more than the wakeup granularity.  Within
+   an interrupt handler, yields on return from the interrupt
+   instead. */
+void
+thread_preempt (void)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  bool preempt;
+
+  if (cur == idle_thread)
+    return;
+  old_level = intr_disable ();
+  if (edf_ready_before (cur))
+    preempt = true;
+  else if (cur->edf_period != 0)
+    preempt = false;
+  else if (thread_cfs)
+    preempt = cfs_ready_before (cur->vruntime - CFS_WAKEUP_GRANULARITY);
+  else
+    preempt = ready_queue_max_priority () > cur->priority;
+  intr_set_level (old_level);
+  if (!preempt)
+    return;
+  if (intr_context ())
+    intr_yield_on_return ();
+  else
+    thread_yield_head (cur);
 }
 
 /* Returns the current thread's priority. */
@@ -527,6 +838,12 @@ thread_set_nice (int nice)
   struct thread *cur;
   cur = thread_current ();
   cur->nice = nice;
+  if (thread_cfs)
+    {
+      /* The new weight applies from the next tick on. */
+      thread_preempt ();
+      return;
+    }
   thread_update_recent_cpu ();
   thread_update_priority ();
 }
@@ -548,82 +865,161 @@ thread_get_load_avg (void)
 void
 thread_update_load_avg (void)
 {
-  int ready_threads;
-  
+  int ready_threads = ready_cnt;
+
   if (thread_current () != idle_thread)
-  {
-    ready_threads = list_size (&ready_list) + 1;
-  }
-  else
-  {
-    ready_threads = list_size (&ready_list);
-  }
+    ready_threads++;
   load_avg = FIXED_POINT_MULT (CONVERT_TO_FP (59) / 60, load_avg) + CONVERT_TO_FP (1) / 60 * ready_threads;
 }
 
 void
 thread_update_recent_cpu (void)
 {
-  thread_update_recent_cpu_for_one (thread_current ());
+  thread_update_recent_cpu_for_one (thread_current (), load_avg);
 }
 
+/* Performs the once-per-second recent_cpu decay.  Only
+   runnable threads are decayed.  A blocked thread would fall out
+   of the load history here only if more threads blocked at once
+   than the catch-up in thread_update_priority_for_all() can get
+   through in CATCH_UP_AGE seconds; such a thread is caught up at
+   once, as a last resort. */
 void
 thread_update_recent_cpu_for_all (void)
 {
-  struct list_elem *e;
-  struct thread *t;
-  
-  e = list_begin (&all_list);
-  while (e != list_end (&all_list))
-  {
-      t = list_entry (e, struct thread, allelem);
-      thread_update_recent_cpu_for_one (t);
-      e = list_next (e);
-  }
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  decay_epoch++;
+  load_history[decay_epoch % LOAD_HISTORY] = load_avg;
+  thread_update_runnable (thread_decay_runnable);
+  thread_catch_up_blocked (LOAD_HISTORY - 1, INT_MAX);
 }
 
 static void
-thread_update_recent_cpu_for_one (struct thread *curr)
+thread_update_recent_cpu_for_one (struct thread *curr, int avg)
 {
   ASSERT (is_thread (curr));
   int load;
   if (curr == idle_thread) return;
-  load = 2 * load_avg;
+  load = 2 * avg;
   curr->recent_cpu = ADD_INT (FIXED_POINT_MULT (FIXED_POINT_DIV (load, ADD_INT (load, 1)), curr->recent_cpu), curr->nice);
 }
 
+/* Applies this second's decay to runnable thread T. */
+static void
+thread_decay_runnable (struct thread *t)
+{
+  thread_update_recent_cpu_for_one (t, load_avg);
+  t->cpu_epoch = decay_epoch;
+}
+
+/* Brings blocked thread T's recent_cpu, and its priority if it
+   missed a refresh, up to date by replaying the per-second
+   decays it missed. */
+static void
+thread_catch_up (struct thread *t)
+{
+  if (t->prio_seq != prio_seq)
+    {
+      for (; t->cpu_epoch < prio_epoch; t->cpu_epoch++)
+        thread_update_recent_cpu_for_one (
+          t, load_history[(t->cpu_epoch + 1) % LOAD_HISTORY]);
+      thread_update_priority_for_one (t);
+      t->prio_seq = prio_seq;
+    }
+  for (; t->cpu_epoch < decay_epoch; t->cpu_epoch++)
+    thread_update_recent_cpu_for_one (
+      t, load_history[(t->cpu_epoch + 1) % LOAD_HISTORY]);
+}
+
+/* Catches up at most MAX_CNT blocked threads whose recent_cpu is
+   AGE or more decays behind, stalest first. */
+static void
+thread_catch_up_blocked (int64_t age, int max_cnt)
+{
+  for (; max_cnt > 0 && !list_empty (&blocked_list); max_cnt--)
+    {
+      struct thread *t = list_entry (list_front (&blocked_list),
+                                     struct thread, blocked_elem);
+      if (t->cpu_epoch + age > decay_epoch)
+        break;
+      list_pop_front (&blocked_list);
+      thread_catch_up (t);
+      list_push_back (&blocked_list, &t->blocked_elem);
+    }
+}
+
 void
 thread_update_priority (void)
 {
   thread_update_priority_for_one (thread_current ());
 }
 
+/* Refreshes the priority of every runnable thread.  Blocked
+   threads pick up the refresh in thread_catch_up(), when they
+   are unblocked or, a few at a time, once they are CATCH_UP_AGE
+   seconds behind. */
 void
 thread_update_priority_for_all (void)
 {
-  struct list_elem *e;
-  struct thread *t;
-  
-  e = list_begin (&all_list);
-  while (e != list_end (&all_list))
-  {
-      t = list_entry (e, struct thread, allelem);
-      thread_update_priority_for_one (t);
-      e = list_next (e);
-  }
-  sort_thread_list (&ready_list);
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  prio_seq++;
+  prio_epoch = decay_epoch;
+  thread_update_runnable (thread_update_priority_for_one);
+  thread_catch_up_blocked (CATCH_UP_AGE, CATCH_UP_BATCH);
 }
 
+/* Calls FUNC on the running thread and on every ready thread.
+   FUNC may move a ready thread to another run queue; a thread
+   moved to a higher queue may then be visited twice. */
+static void
+thread_update_runnable (void (*func) (struct thread *))
+{
+  int i;
+
+  func (thread_current ());
+  for (i = 0; i < PRI_CNT; i++)
+    if (ready_bitmap & ((uint64_t) 1 << i))
+      {
+        struct list_elem *e = list_begin (&ready_queues[i]);
+        while (e != list_end (&ready_queues[i]))
+          {
+            struct list_elem *next = list_next (e);
+            func (list_entry (e, struct thread, elem));
+            e = next;
+          }
+      }
+}
+
+/* Recomputes the MLFQS priority of CURR.  A ready thread whose
+   priority changes is moved to the tail of its new run queue,
+   and a thread waiting on a semaphore to its new place among the
+   semaphore's waiters. */
 static void
 thread_update_priority_for_one (struct thread *curr)
 {
+  int priority;
+
   ASSERT (is_thread (curr)); 
-  if (curr == idle_thread || curr == wakeup_thread) return;
-  curr->priority = PRI_MAX - CONVERT_TO_NEAREST_INT (curr->recent_cpu / 4) - curr->nice * 2;
-  if (curr->priority > PRI_MAX)
-      curr->priority = PRI_MAX;
-  else if (curr->priority < PRI_MIN)
-      curr->priority = PRI_MIN;
+  if (curr == idle_thread || curr->edf_period != 0) return;
+  priority = PRI_MAX - CONVERT_TO_NEAREST_INT (curr->recent_cpu / 4) - curr->nice * 2;
+  if (priority > PRI_MAX)
+      priority = PRI_MAX;
+  else if (priority < PRI_MIN)
+      priority = PRI_MIN;
+
+  if (curr->status == THREAD_READY && curr->priority != priority)
+    {
+      ready_queue_remove (curr);
+      curr->priority = priority;
+      ready_queue_insert (curr, false);
+    }
+  else if (curr->status == THREAD_BLOCKED && curr->waiting_sema != NULL
+           && curr->priority != priority)
+    sema_reprioritize (curr->waiting_sema, curr, priority);
+  else
+    curr->priority = priority;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
@@ -656,6 +1052,20 @@ idle (void *idle_started_ UNUSED)
       intr_disable ();
       thread_block ();
 
+      /* Zero a few free pages for later PAL_ZERO allocations,
+         with interrupts on so that they are not held up.  If an
+         interrupt made a thread ready meanwhile, run it instead
+         of halting. */
+      intr_enable ();
+      palloc_zero_idle ();
+      intr_disable ();
+      if (ready_cnt > 0)
+        continue;
+
+      /* Nothing else is runnable, so the periodic tick can be
+         stopped until the next timer deadline. */
+      timer_idle_enter ();
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -718,6 +1128,9 @@ init_thread (struct thread *t, const char *name, int priority)
   strlcpy (t->name, name, sizeof t->name);
   t->stack = (uint8_t *) t + PGSIZE;
   t->priority = priority;
+  t->base_priority = priority;
+  list_init (&t->locks);
+  t->waiting_lock = NULL;
   t->magic = THREAD_MAGIC;
   t->sleep_endtick = 0;
   if (thread_mlfqs)
@@ -727,7 +1140,13 @@ init_thread (struct thread *t, const char *name, int priority)
       t->recent_cpu = 0;
     else
       t->recent_cpu = thread_get_recent_cpu ();
+    t->cpu_epoch = decay_epoch;
+    t->prio_seq = prio_seq;
+    if (t != initial_thread)
+      list_push_back (&blocked_list, &t->blocked_elem);
   }
+  if (thread_cfs)
+    t->vruntime = min_vruntime;
   list_push_back (&all_list, &t->allelem);
 }
 
@@ -752,10 +1171,274 @@ alloc_frame (struct thread *t, size_t size)
 static struct thread *
 next_thread_to_run (void) 
 {
-  if (list_empty (&ready_list))
-    return idle_thread;
+  struct thread *t = ready_queue_pop ();
+
+  return t != NULL ? t : idle_thread;
+}
+
+/* Adds ready thread T to the run queue for its priority, at the
+   front if AT_FRONT is true, otherwise at the back.  Under the
+   CFS, T is placed by its vruntime, and an EDF thread by its
+   deadline; either way AT_FRONT is ignored.  Interrupts must be
+   off. */
+static void
+ready_queue_insert (struct thread *t, bool at_front)
+{
+  int idx = t->priority - PRI_MIN;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (idx >= 0 && idx < PRI_CNT);
+
+  if (t->edf_period != 0)
+    rbtree_insert (&edf_tree, &t->tree_elem);
+  else if (thread_cfs)
+    {
+      rbtree_insert (&cfs_tree, &t->tree_elem);
+      cfs_load += cfs_weight (t);
+    }
+  else 
+    {
+      if (at_front)
+        list_push_front (&ready_queues[idx], &t->elem);
+      else
+        list_push_back (&ready_queues[idx], &t->elem);
+      ready_bitmap |= (uint64_t) 1 << idx;
+    }
+  ready_cnt++;
+}
+
+/* Removes T from the run queue for its priority.  T's priority
+   must not have changed since it was inserted.  Interrupts must
+   be off. */
+static void
+ready_queue_remove (struct thread *t)
+{
+  int idx = t->priority - PRI_MIN;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (idx >= 0 && idx < PRI_CNT);
+
+  if (t->edf_period != 0)
+    rbtree_remove (&edf_tree, &t->tree_elem);
+  else if (thread_cfs)
+    {
+      rbtree_remove (&cfs_tree, &t->tree_elem);
+      cfs_load -= cfs_weight (t);
+    }
+  else
+    {
+      list_remove (&t->elem);
+      if (list_empty (&ready_queues[idx]))
+        ready_bitmap &= ~((uint64_t) 1 << idx);
+    }
+  ready_cnt--;
+}
+
+/* Removes and returns the EDF thread in the run queue with the
+   earliest deadline, if any, otherwise the highest-priority
+   thread, or under the CFS the one with the least vruntime.
+   Returns a null pointer if the run queue is empty.  Interrupts
+   must be off. */
+static struct thread *
+ready_queue_pop (void)
+{
+  struct thread *t = NULL;
+  int priority = ready_queue_max_priority ();
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!rbtree_empty (&edf_tree))
+    {
+      struct rbtree_elem *e = rbtree_min (&edf_tree);
+      t = rbtree_entry (e, struct thread, tree_elem);
+      rbtree_remove (&edf_tree, e);
+      ready_cnt--;
+    }
+  else if (thread_cfs)
+    {
+      struct rbtree_elem *e = rbtree_min (&cfs_tree);
+      if (e != NULL)
+        {
+          t = rbtree_entry (e, struct thread, tree_elem);
+          rbtree_remove (&cfs_tree, e);
+          cfs_load -= cfs_weight (t);
+          ready_cnt--;
+        }
+    }
+  else if (priority >= PRI_MIN)
+    {
+      int idx = priority - PRI_MIN;
+      t = list_entry (list_pop_front (&ready_queues[idx]),
+                      struct thread, elem);
+      if (list_empty (&ready_queues[idx]))
+        ready_bitmap &= ~((uint64_t) 1 << idx);
+      ready_cnt--;
+    }
+  return t;
+}
+
+/* Returns the highest priority among the threads in the
+   priority run queues, or PRI_MIN - 1 if they are empty.  Threads
+   in the CFS and EDF trees are not counted.  The bitmap is scanned
+   as two 32-bit halves so that the bit scan compiles to a single
+   BSR without needing libgcc. */
+static int
+ready_queue_max_priority (void)
+{
+  uint32_t hi = ready_bitmap >> 32;
+  uint32_t lo = ready_bitmap;
+
+  if (hi != 0)
+    return PRI_MIN + 63 - __builtin_clz (hi);
+  else if (lo != 0)
+    return PRI_MIN + 31 - __builtin_clz (lo);
   else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+    return PRI_MIN - 1;
+}
+
+/* Returns T's CFS weight. */
+static uint32_t
+cfs_weight (const struct thread *t)
+{
+  ASSERT (t->nice >= NICE_MIN && t->nice <= NICE_MAX);
+
+  return cfs_weights[t->nice - NICE_MIN];
+}
+
+/* Orders threads by ascending vruntime. */
+static bool
+cfs_less (const struct rbtree_elem *a_, const struct rbtree_elem *b_,
+          void *aux UNUSED)
+{
+  const struct thread *a = rbtree_entry (a_, struct thread, tree_elem);
+  const struct thread *b = rbtree_entry (b_, struct thread, tree_elem);
+
+  return a->vruntime < b->vruntime;
+}
+
+/* Returns true if the run queue holds a thread whose vruntime
+   is less than VRUNTIME.  Interrupts must be off. */
+static bool
+cfs_ready_before (int64_t vruntime)
+{
+  struct rbtree_elem *e = rbtree_min (&cfs_tree);
+
+  return (e != NULL
+          && rbtree_entry (e, struct thread, tree_elem)->vruntime < vruntime);
+}
+
+/* Advances min_vruntime to the least vruntime among the running
+   and ready threads, if that is greater.  Interrupts must be
+   off. */
+static void
+cfs_update_min_vruntime (void)
+{
+  struct thread *cur = running_thread ();
+  struct rbtree_elem *e;
+  int64_t vruntime;
+  bool valid = false;
+
+  if (cur != idle_thread && cur->edf_period == 0)
+    {
+      vruntime = cur->vruntime;
+      valid = true;
+    }
+  e = rbtree_min (&cfs_tree);
+  if (e != NULL)
+    {
+      int64_t v = rbtree_entry (e, struct thread, tree_elem)->vruntime;
+      if (!valid || v < vruntime)
+        vruntime = v;
+      valid = true;
+    }
+  if (valid && vruntime > min_vruntime)
+    min_vruntime = vruntime;
+}
+
+/* Charges running thread T for one tick of CPU time.  Returns
+   true if T has used up its slice and should yield to a ready
+   thread with less vruntime. */
+static bool
+cfs_tick (struct thread *t)
+{
+  uint32_t weight = cfs_weight (t);
+  uint32_t period, slice;
+
+  t->vruntime += ((uint32_t) CFS_WEIGHT_NICE_0 << 20) / weight;
+  cfs_update_min_vruntime ();
+
+  period = CFS_LATENCY;
+  if ((ready_cnt + 1) * CFS_MIN_GRANULARITY > period)
+    period = (ready_cnt + 1) * CFS_MIN_GRANULARITY;
+  slice = period * weight / (cfs_load + weight);
+  if (slice < CFS_MIN_GRANULARITY)
+    slice = CFS_MIN_GRANULARITY;
+
+  return thread_ticks >= slice && cfs_ready_before (t->vruntime);
+}
+
+/* Returns the utilization of an EDF thread with the given
+   PERIOD and BUDGET, in units of 1 / EDF_UTIL_SCALE. */
+static uint32_t
+edf_util (int64_t period, int64_t budget)
+{
+  return DIV_ROUND_UP (budget * EDF_UTIL_SCALE, period);
+}
+
+/* Orders EDF threads by ascending deadline. */
+static bool
+edf_less (const struct rbtree_elem *a_, const struct rbtree_elem *b_,
+          void *aux UNUSED)
+{
+  const struct thread *a = rbtree_entry (a_, struct thread, tree_elem);
+  const struct thread *b = rbtree_entry (b_, struct thread, tree_elem);
+
+  return a->edf_deadline < b->edf_deadline;
+}
+
+/* Returns true if the run queue holds an EDF thread that should
+   run before T.  Interrupts must be off. */
+static bool
+edf_ready_before (const struct thread *t)
+{
+  struct rbtree_elem *e = rbtree_min (&edf_tree);
+
+  return (e != NULL
+          && (t->edf_period == 0
+              || (rbtree_entry (e, struct thread, tree_elem)->edf_deadline
+                  < t->edf_deadline)));
+}
+
+/* Starts EDF thread T's next job with a fresh budget.  The job
+   is released at the end of T's current period, or at the
+   latest period boundary that has already passed if T is
+   running late.  Returns the release time. */
+static int64_t
+edf_next_job (struct thread *t)
+{
+  int64_t now = timer_ticks ();
+  int64_t release = t->edf_deadline;
+
+  while (release + t->edf_period <= now)
+    release += t->edf_period;
+  t->edf_deadline = release + t->edf_period;
+  t->edf_remaining = t->edf_budget;
+  return release;
+}
+
+/* Suspends running EDF thread CUR, which has used up its budget
+   without finishing its job, until its next period starts.  The
+   job cannot finish by its deadline, so that counts as a miss.
+   Interrupts must be off. */
+static void
+edf_throttle (struct thread *cur)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  cur->edf_throttled = false;
+  edf_misses++;
+  if (timer_add (cur, edf_next_job (cur)))
+    thread_block ();
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -781,6 +1464,8 @@ thread_schedule_tail (struct thread *prev)
   ASSERT (intr_get_level () == INTR_OFF);
   /* Mark us as running. */
   cur->status = THREAD_RUNNING;
+  if (thread_cfs)
+    cfs_update_min_vruntime ();
   /* Start new time slice. */
   thread_ticks = 0;
 #ifdef USERPROG
@@ -796,7 +1481,7 @@ thread_schedule_tail (struct thread *prev)
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) 
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      free_thread_page (prev);
     }
 }
 
@@ -818,11 +1503,56 @@ schedule (void)
   ASSERT (cur->status != THREAD_RUNNING);
   ASSERT (is_thread (next));
 
+  if (cur == idle_thread)
+    timer_idle_exit ();
   if (cur != next)
        prev = switch_threads (cur, next);
   thread_schedule_tail (prev);
 }
 
+/* Returns a page for a new thread, or a null pointer if none is
+   available.  The page's contents are arbitrary: init_thread()
+   initializes the struct thread at its bottom and
+   thread_create() builds the stack frames at its top, and
+   nothing else in the page is read before it is written. */
+static struct thread *
+alloc_thread_page (void)
+{
+  struct thread *t = NULL;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (page_cache_cnt > 0)
+    {
+      t = page_cache[--page_cache_cnt];
+      pages_recycled++;
+    }
+  intr_set_level (old_level);
+
+  if (t == NULL)
+    {
+      t = palloc_get_page (0);
+      if (t != NULL)
+        pages_allocated++;
+    }
+  return t;
+}
+
+/* Frees dead thread T's page, keeping it for reuse if the cache
+   has room.  Interrupts must be off. */
+static void
+free_thread_page (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* Make stale pointers to T fail is_thread(). */
+  t->magic = 0;
+  if (page_cache_cnt < PAGE_CACHE_SIZE)
+    page_cache[page_cache_cnt++] = t;
+  else
+    palloc_free_page (t);
+}
+
 /* Returns a tid to use for a new thread. */
 static tid_t
 allocate_tid (void) 
@@ -837,55 +1567,41 @@ allocate_tid (void)
   return tid;
 }
 
-
-static bool
-thread_sort_desc (const struct list_elem *left, const struct list_elem *right, void *aux UNUSED)
-{
-  struct thread *a, *b;
-  ASSERT (left != NULL && right != NULL);
-  a = list_entry (left, struct thread, elem);
-  b = list_entry (right, struct thread, elem);
-  return (a->priority > b->priority);
-}
-
-/* put the threads who has outstanding priority to the head of the list */
-void
-sort_thread_list (struct list *l)
+/* Returns the thread with the given TID, or a null pointer if
+   there is none or it has exited. */
+struct thread *
+get_thread_elem (tid_t tid)
 {
-  if (list_empty (l)) return;
-  list_sort (l, thread_sort_desc, NULL);
-}
+  struct list *bucket = &tid_index[(unsigned) tid % TID_BUCKETS];
+  struct thread *found = NULL;
+  struct list_elem *e;
+  enum intr_level old_level;
 
-/* same as thread_sort_desc but use > instead of >= */
-static bool
-thread_insert_desc_begin (const struct list_elem *left, const struct list_elem *right, void *aux UNUSED)
-{
-  struct thread *a, *b;
-  ASSERT (left != NULL && right != NULL);
-  a = list_entry (left, struct thread, elem);
-  b = list_entry (right, struct thread, elem);
-  return (a->priority >= b->priority);
+  old_level = intr_disable ();
+  for (e = list_begin (bucket); e != list_end (bucket); e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, tid_elem);
+      if (t->tid == tid)
+        {
+          found = t;
+          break;
+        }
+    }
+  intr_set_level (old_level);
+  ASSERT (found == NULL || is_thread (found));
+  return found;
 }
 
-/* same as thread_sort_desc but used for Round-Robin Scheduling*/
-static bool
-thread_insert_desc_end (const struct list_elem *left, const struct list_elem *right, void *aux UNUSED)
+/* Adds T, which has just been given its tid, to the tid index. */
+static void
+tid_index_insert (struct thread *t)
 {
-  return thread_sort_desc (left, right, NULL);
-}
+  enum intr_level old_level;
 
-struct thread *
-get_thread_elem (tid_t tid)
-{
-  struct list_elem *temp;
-  struct thread *ret = NULL;
-  for (temp = list_begin (&all_list); temp != list_end (&all_list); temp = list_next (temp))
-    {
-      ret = list_entry (temp, struct thread, allelem);
-      ASSERT (is_thread (ret));
-      if (ret->tid == tid) return ret;
-    }
-  return NULL;
+  old_level = intr_disable ();
+  list_push_back (&tid_index[(unsigned) t->tid % TID_BUCKETS],
+                  &t->tid_elem);
+  intr_set_level (old_level);
 }
 
 /* Offset of `stack' member within `struct thread'.
@@ -2,7 +2,9 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <hash.h>
 #include <list.h>
+#include <rbtree.h>
 #include <stdint.h>
 
 #include "threads/synch.h"
@@ -87,12 +89,13 @@ typedef int tid_t;
    the `magic' member of the running thread's `struct thread' is
    set to THREAD_MAGIC.  Stack overflow will normally change this
    value, triggering the assertion. */
-/* The `elem' member has a dual purpose.  It can be an element in
-   the run queue (thread.c), or it can be an element in a
-   semaphore wait list (synch.c).  It can be used these two ways
-   only because they are mutually exclusive: only a thread in the
-   ready state is on the run queue, whereas only a thread in the
-   blocked state is on a semaphore wait list. */
+/* The `tree_elem' member has a dual purpose.  It can be an
+   element in a CFS or EDF run queue (thread.c), or it can be an
+   element in a semaphore's waiters (synch.c).  It can be used
+   these two ways only because they are mutually exclusive: only
+   a thread in the ready state is on a run queue, whereas only a
+   thread in the blocked state is waiting on a semaphore.  The
+   `elem' member is used only by the priority run queues. */
 struct thread
   {
     /* Owned by thread.c. */
@@ -100,18 +103,35 @@ struct thread
     enum thread_status status;          /* Thread state. */
     char name[16];                      /* Name (for debugging purposes). */
     uint8_t *stack;                     /* Saved stack pointer. */
-    int priority;                       /* Priority. */
+    int priority;                       /* Effective priority, including donations. */
+    int base_priority;                  /* Priority before donations. */
+    struct list locks;                  /* Locks held, for priority donation. */
+    struct lock *waiting_lock;          /* Lock being waited for, or NULL. */
+    struct semaphore *waiting_sema;     /* Semaphore being waited on, or NULL. */
     struct list_elem allelem;           /* List element for all threads list. */
+    struct list_elem tid_elem;          /* List element in tid index. */
      
-    struct list_elem wait_elem;          /* List element, stored in the wait_list queue */
+    struct list_elem wait_elem;         /* List element in a timer wheel slot (timer.c). */
 
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
 
-    int64_t sleep_endtick;              /* The tick after which the thread should awake (if the thread is in sleep) */
+    int64_t sleep_endtick;              /* Tick at which the thread should awake, or 0 if it is not on the timer wheel. */
 
     int nice;                           /* nice value of a thread */
     int recent_cpu;                     /* recent cpu usage */
+    int64_t cpu_epoch;                  /* Per-second decays applied to recent_cpu. */
+    unsigned prio_seq;                  /* Priority refreshes applied while blocked. */
+    struct list_elem blocked_elem;      /* List element in blocked_list (MLFQS). */
+    int64_t vruntime;                   /* Weighted CPU time received (CFS). */
+    struct rbtree_elem tree_elem;       /* Run queue or semaphore waiters element. */
+
+    /* Earliest-deadline-first class (thread.c). */
+    int64_t edf_period;                 /* Ticks per job, or 0 if not EDF. */
+    int64_t edf_budget;                 /* CPU ticks allowed per job. */
+    int64_t edf_remaining;              /* Budget left in current job. */
+    int64_t edf_deadline;               /* End of current period. */
+    bool edf_throttled;                 /* Budget exhausted, must yield. */
 
 
 #ifdef USERPROG
@@ -127,6 +147,12 @@ struct thread
   struct list files;                 /* Files used by current thread */
   int exit_status;                   /* return status of the thread */
   bool exited;                       /* whether the thread is exited or not */
+#ifdef VM
+  struct hash pages;                 /* Supplemental page table (vm/page.c). */
+  struct list mappings;              /* Memory-mapped files (vm/mmap.c). */
+  int next_mapid;                    /* Next mapping identifier. */
+  void *user_esp;                    /* User stack pointer on kernel entry. */
+#endif
    
 #endif     
     
@@ -139,15 +165,23 @@ struct thread
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler instead.
+   Controlled by kernel command-line option "-cfs". */
+extern bool thread_cfs;
+
 void thread_init (void);
 void thread_start (void);
 
-void thread_tick (int64_t);
-void thread_wake_up (int64_t);
+void thread_tick (void);
+void thread_tick_idle (void);
 void thread_print_stats (void);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
+tid_t thread_create_deadline (const char *name, int64_t period,
+                              int64_t budget, thread_func *, void *);
+void thread_wait_next_period (void);
+long long thread_get_edf_misses (void);
 
 void thread_block (void);
 void thread_unblock (struct thread *);
@@ -158,13 +192,11 @@ const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
-void thread_sleep_till (int64_t);
 
 /* Performs some operation on thread t, given auxiliary data AUX. */
 typedef void thread_action_func (struct thread *t, void *aux);
 void thread_foreach (thread_action_func *, void *);
 
-void sort_thread_list (struct list *l);
 void thread_yield_head (struct thread *curr);
 
 void thread_update_load_avg (void);
@@ -176,6 +208,8 @@ struct thread *get_thread_elem (tid_t);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
+void thread_refresh_priority (struct thread *);
+void thread_preempt (void);
 
 int thread_get_nice (void);
 void thread_set_nice (int);
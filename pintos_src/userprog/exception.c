@@ -7,6 +7,9 @@
 
 #include "threads/vaddr.h"
 #include "userprog/syscall.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
@@ -151,6 +154,21 @@ page_fault (struct intr_frame *f)
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
+#ifdef VM
+  /* Bring in the page if it belongs to the process but hasn't
+     been touched yet, or copy it if the process shares it
+     copy-on-write.  The kernel faults here too when it touches
+     user memory on the process's behalf, and then the user stack
+     pointer is the one saved on entry to the system call. */
+  if (user)
+    thread_current ()->user_esp = f->esp;
+  if (not_present ? page_fault_in (fault_addr)
+      : write && page_unshare (fault_addr))
+    return;
+  if (is_user_vaddr (fault_addr))
+    sys_exit (-1);
+#endif
+
    if (not_present || (is_kernel_vaddr (fault_addr) && user)) sys_exit (-1);
   
   // if(!user) 
@@ -0,0 +1,196 @@
+#include "userprog/futex.h"
+#include <hash.h>
+#include <list.h>
+#include <stdint.h>
+#include <syscall-nr.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
+
+/* Fast user-space mutexes.
+
+   A futex is any aligned word in a user process's memory.  User
+   code manipulates the word with atomic instructions and enters
+   the kernel only to sleep until the word changes or to wake the
+   threads sleeping on it.
+
+   Sleepers are keyed by the kernel virtual address of the word,
+   which names the physical frame and offset behind the user
+   address.  Two virtual addresses that map the same memory thus
+   share a wait queue, even in different address spaces.  Only
+   virtual memory lets processes share memory: processes that
+   map the same file with mmap() share the frames of its pages
+   (see vm/page.c), so a futex in a mapped file synchronizes
+   them.
+
+   With virtual memory, the word's page is pinned while a thread
+   sleeps on it, so that eviction cannot move it to another
+   frame and change its key.  A page that fork() shares
+   copy-on-write is made private first, since the first write to
+   it would move it anyway; mapped pages stay shared.
+
+   Each waiter lives on its thread's kernel stack for as long as
+   the thread sleeps.  The wait queues are only touched with
+   interrupts off, so checking the word and queuing behind it is
+   atomic with respect to futex_wake(). */
+
+/* Number of wait queue buckets. */
+#define FUTEX_BUCKETS 64
+
+static struct list buckets[FUTEX_BUCKETS];
+
+/* A thread sleeping in futex_wait(). */
+struct futex_waiter
+  {
+    const int *key;             /* Kernel address of the futex word. */
+    struct thread *thread;      /* Sleeping thread. */
+    struct list_elem elem;      /* Element in a bucket. */
+    bool woken;                 /* Dequeued by futex_wake()? */
+  };
+
+/* Initializes the futex wait queues. */
+void
+futex_init (void) 
+{
+  size_t i;
+
+  for (i = 0; i < FUTEX_BUCKETS; i++)
+    list_init (&buckets[i]);
+}
+
+/* Returns the kernel address of the futex word at user address
+   UADDR in the running process, or a null pointer if UADDR is
+   not a mapped, aligned user address.  Alignment keeps the word
+   from straddling two pages.  With virtual memory, the word's
+   page is brought in and pinned, and a successful call must be
+   balanced by futex_put(). */
+static int *
+futex_key (int *uaddr) 
+{
+  if (uaddr == NULL || !is_user_vaddr (uaddr)
+      || (uintptr_t) uaddr % sizeof *uaddr != 0)
+    return NULL;
+#ifdef VM
+  if (!page_pin (uaddr, true))
+    return NULL;
+#endif
+  return pagedir_get_page (thread_current ()->pagedir, uaddr);
+}
+
+/* Releases the futex word at UADDR, obtained with futex_key(). */
+static void
+futex_put (int *uaddr UNUSED) 
+{
+#ifdef VM
+  page_unpin (uaddr);
+#endif
+}
+
+/* Returns the wait queue for KEY. */
+static struct list *
+futex_bucket (const int *key) 
+{
+  return &buckets[hash_int ((uintptr_t) key / sizeof *key) % FUTEX_BUCKETS];
+}
+
+/* If the word at user address UADDR holds EXPECTED, sleeps until
+   futex_wake() is called on the same word or, if TIMEOUT is
+   positive, until TIMEOUT timer ticks have passed.  Returns
+   FUTEX_MISMATCH without sleeping if the word holds some other
+   value, FUTEX_TIMEDOUT if the timeout expired, FUTEX_WOKEN
+   otherwise, or -1 if UADDR is not a valid futex address.  Like
+   any futex, the caller must tolerate spurious wakeups. */
+int
+futex_wait (int *uaddr, int expected, int timeout) 
+{
+  struct futex_waiter w;
+  enum intr_level old_level;
+  int64_t deadline = 0;
+  int result = FUTEX_WOKEN;
+
+  w.key = futex_key (uaddr);
+  if (w.key == NULL)
+    return -1;
+  w.thread = thread_current ();
+  w.woken = false;
+
+  old_level = intr_disable ();
+  if (*w.key != expected)
+    {
+      intr_set_level (old_level);
+      futex_put (uaddr);
+      return FUTEX_MISMATCH;
+    }
+  list_push_back (futex_bucket (w.key), &w.elem);
+  if (timeout > 0)
+    {
+      deadline = timer_ticks () + timeout;
+      timer_add (w.thread, deadline);
+    }
+  thread_block ();
+
+  timer_cancel (w.thread);
+  if (!w.woken)
+    {
+      list_remove (&w.elem);
+      if (deadline != 0 && timer_ticks () >= deadline)
+        result = FUTEX_TIMEDOUT;
+    }
+  intr_set_level (old_level);
+  futex_put (uaddr);
+
+  return result;
+}
+
+/* Wakes up to N threads sleeping on the word at user address
+   UADDR, in the order they went to sleep.  Returns the number of
+   threads woken, or -1 if UADDR is not a valid futex address. */
+int
+futex_wake (int *uaddr, int n) 
+{
+  const int *key = futex_key (uaddr);
+  struct list *bucket;
+  struct list_elem *e;
+  enum intr_level old_level;
+  int woken = 0;
+
+  if (key == NULL)
+    return -1;
+
+  bucket = futex_bucket (key);
+  old_level = intr_disable ();
+  for (e = list_begin (bucket); e != list_end (bucket) && woken < n; )
+    {
+      struct futex_waiter *w = list_entry (e, struct futex_waiter, elem);
+      if (w->key != key)
+        {
+          e = list_next (e);
+          continue;
+        }
+
+      /* A waiter whose timeout just fired is already ready to
+         run; dequeuing it is enough to hand it the wakeup.
+         Otherwise its timeout must be disarmed before it is
+         unblocked, or the timer would unblock it a second time
+         if the deadline passed before it got to run. */
+      e = list_remove (e);
+      w->woken = true;
+      if (w->thread->status == THREAD_BLOCKED)
+        {
+          timer_cancel (w->thread);
+          thread_unblock (w->thread);
+        }
+      woken++;
+    }
+  intr_set_level (old_level);
+  futex_put (uaddr);
+
+  if (woken > 0)
+    thread_preempt ();
+  return woken;
+}
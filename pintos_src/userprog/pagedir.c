@@ -47,6 +47,44 @@ pagedir_destroy (uint32_t *pd)
   palloc_free_page (pd);
 }
 
+/* Gives page directory DST a private copy of each user page
+   mapped in SRC, at the same address and with the same
+   writability.  DST must have no user mappings yet.  Returns true
+   if successful, false if memory ran out; any pages copied so
+   far stay in DST, for pagedir_destroy() to free. */
+bool
+pagedir_copy (uint32_t *dst, uint32_t *src) 
+{
+  uint32_t *pde;
+
+  ASSERT (src != init_page_dir);
+  for (pde = src; pde < src + pd_no (PHYS_BASE); pde++)
+    if (*pde & PTE_P) 
+      {
+        uint32_t *pt = pde_get_pt (*pde);
+        size_t i;
+
+        for (i = 0; i < PGSIZE / sizeof *pt; i++)
+          if (pt[i] & PTE_P) 
+            {
+              void *upage = (void *) (((uintptr_t) (pde - src) << PDSHIFT)
+                                      | (i << PTSHIFT));
+              void *kpage = palloc_get_page (PAL_USER);
+
+              if (kpage == NULL)
+                return false;
+              memcpy (kpage, pte_get_page (pt[i]), PGSIZE);
+              if (!pagedir_set_page (dst, upage, kpage,
+                                     (pt[i] & PTE_W) != 0)) 
+                {
+                  palloc_free_page (kpage);
+                  return false;
+                }
+            }
+      }
+  return true;
+}
+
 /* Returns the address of the page table entry for virtual
    address VADDR in page directory PD.
    If PD does not have a page table for VADDR, behavior depends
@@ -214,6 +252,25 @@ pagedir_set_accessed (uint32_t *pd, const void *vpage, bool accessed)
     }
 }
 
+/* Sets the writable bit to WRITABLE in the PTE for virtual page
+   VPAGE in PD.  Copy-on-write sharing clears it and sets it
+   again once the page is private. */
+void
+pagedir_set_writable (uint32_t *pd, const void *vpage, bool writable) 
+{
+  uint32_t *pte = lookup_page (pd, vpage, false);
+  if (pte != NULL) 
+    {
+      if (writable)
+        *pte |= PTE_W;
+      else 
+        {
+          *pte &= ~(uint32_t) PTE_W;
+          invalidate_pagedir (pd);
+        }
+    }
+}
+
 /* Loads page directory PD into the CPU's page directory base
    register. */
 void
@@ -17,12 +17,28 @@
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#ifdef VM
+#include "vm/mmap.h"
+#include "vm/page.h"
+#endif
 
 #include "threads/malloc.h"
 #include "userprog/syscall.h" 
 
 static thread_func start_process NO_RETURN;
+static thread_func start_fork NO_RETURN;
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
+static bool copy_process (struct thread *parent);
+
+/* Passed from process_fork() to the new process. */
+struct fork_info
+  {
+    struct intr_frame frame;    /* Parent's user context. */
+    struct thread *parent;      /* Forking process. */
+    struct semaphore go;        /* Upped when the child may start. */
+    struct semaphore done;      /* Upped when the copy is finished. */
+    bool success;               /* Was the copy successful? */
+  };
 
 void test_stack(int *t);
 void push_args(void **esp, int offs[], int argc, char* file_name, size_t len);
@@ -79,6 +95,109 @@ done:
   return tid;
 }
 
+/* Starts a new process that is a copy of the running one.  The
+   copy resumes from the system call whose user context is F, as
+   if the call had returned 0.  It gets the parent's address
+   space, shared copy-on-write under virtual memory and copied
+   outright otherwise, and a copy of each open file.  Returns the
+   new process's thread id, or TID_ERROR if it cannot be
+   created. */
+tid_t
+process_fork (const struct intr_frame *f) 
+{
+  struct fork_info info;
+  tid_t tid;
+
+  info.frame = *f;
+  info.parent = thread_current ();
+  sema_init (&info.go, 0);
+  sema_init (&info.done, 0);
+
+  tid = thread_create (thread_name (), thread_get_priority (),
+                       start_fork, &info);
+  if (tid == TID_ERROR)
+    return TID_ERROR;
+
+  /* thread_create() has now made the child ours, so it may start
+     copying.  We must not run until it is done. */
+  sema_up (&info.go);
+  sema_down (&info.done);
+  return info.success ? tid : TID_ERROR;
+}
+
+/* A thread function that copies its parent process and starts
+   it running. */
+static void
+start_fork (void *info_) 
+{
+  struct fork_info *info = info_;
+  struct intr_frame if_;
+  bool success;
+
+  sema_down (&info->go);
+  if_ = info->frame;
+  success = copy_process (info->parent);
+
+  /* A failed child was never seen by user code, so leave the
+     parent's children before it runs again.  Then nobody waits
+     for us and we exit without reporting a status. */
+  if (!success) 
+    {
+      enum intr_level old_level = intr_disable ();
+      list_remove (&thread_current ()->children_elem);
+      thread_current ()->parent = NULL;
+      intr_set_level (old_level);
+    }
+
+  /* INFO is gone once the parent is released. */
+  info->success = success;
+  sema_up (&info->done);
+  if (!success) 
+    sys_exit (-1);
+
+  /* Return 0 from the system call to user code. */
+  if_.eax = 0;
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
+/* Copies PARENT's address space, image file, and open files into
+   the current thread.  PARENT must not run meanwhile.  Returns
+   true if successful, false otherwise. */
+static bool
+copy_process (struct thread *parent) 
+{
+  struct thread *t = thread_current ();
+
+  t->pagedir = pagedir_create ();
+  if (t->pagedir == NULL)
+    return false;
+#ifdef VM
+  mmap_table_init ();
+  if (!page_table_init ())
+    {
+      pagedir_destroy (t->pagedir);
+      t->pagedir = NULL;
+      return false;
+    }
+#endif
+  process_activate ();
+
+  t->self = file_reopen (parent->self);
+  if (t->self == NULL)
+    return false;
+  file_deny_write (t->self);
+
+#ifdef VM
+  if (!page_table_copy (parent))
+    return false;
+#else
+  if (!pagedir_copy (t->pagedir, parent->pagedir))
+    return false;
+#endif
+  return syscall_copy_files (parent);
+}
+
 void push_args(void **esp, int offs[], int argc, char* file_name, size_t len)
 {
       int size = 0, i;
@@ -160,7 +279,9 @@ start_process (void *file_name_)
   //ADDITIONAL
   if (success)
   {
+#ifndef VM
       t->self = filesys_open (file_name);
+#endif
       file_deny_write (t->self);
       push_args(&if_.esp, offs, argc, file_name, len);
       sema_up (&t->sema_begin);
@@ -253,7 +374,7 @@ process_exit (void)
   uint32_t *pd;
 
  //ADDITIONAL
-  while (!list_empty (&((cur->wait).waiters))) sema_up (&cur->wait);
+  while (!rbtree_empty (&((cur->wait).waiters))) sema_up (&cur->wait);
   file_close (cur->self);
   cur->self = NULL;
   cur->exited = true;
@@ -275,6 +396,10 @@ process_exit (void)
          directory before destroying the process's page
          directory, or our active page directory will be one
          that's been freed (and cleared). */
+#ifdef VM
+      mmap_unmap_all ();
+      page_table_destroy ();
+#endif
       cur->pagedir = NULL;
       pagedir_activate (NULL);
       pagedir_destroy (pd);
@@ -387,6 +512,15 @@ load (const char *file_name, void (**eip) (void), void **esp)
   t->pagedir = pagedir_create ();
   if (t->pagedir == NULL) 
     goto done;
+#ifdef VM
+  mmap_table_init ();
+  if (!page_table_init ())
+    {
+      pagedir_destroy (t->pagedir);
+      t->pagedir = NULL;
+      goto done;
+    }
+#endif
   process_activate ();
 
   /* Open executable file. */
@@ -480,13 +614,24 @@ load (const char *file_name, void (**eip) (void), void **esp)
 
  done:
   /* We arrive here whether the load is successful or not. */
+#ifdef VM
+  /* Pages are read from the executable on demand, so it stays
+     open as the process's image file. */
+  if (success) 
+    {
+      t->self = file;
+      file = NULL;
+    }
+#endif
   file_close (file);
   return success;
 }
 
 /* load() helpers. */
 
+#ifndef VM
 static bool install_page (void *upage, void *kpage, bool writable);
+#endif
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -545,6 +690,10 @@ validate_segment (const struct Elf32_Phdr *phdr, struct file *file)
    The pages initialized by this function must be writable by the
    user process if WRITABLE is true, read-only otherwise.
 
+   With virtual memory, the pages are only recorded in the
+   supplemental page table here, and FILE must stay open.  They
+   are read or zeroed when first touched.
+
    Return true if successful, false if a memory allocation error
    or disk read error occurs. */
 static bool
@@ -555,7 +704,9 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
   ASSERT (pg_ofs (upage) == 0);
   ASSERT (ofs % PGSIZE == 0);
 
+#ifndef VM
   file_seek (file, ofs);
+#endif
   while (read_bytes > 0 || zero_bytes > 0) 
     {
       /* Calculate how to fill this page.
@@ -564,6 +715,14 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
       size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
+#ifdef VM
+      /* Record where the page comes from. */
+      if (page_read_bytes > 0
+          ? page_add_file (upage, file, ofs, page_read_bytes, writable) == NULL
+          : page_add_zero (upage, writable) == NULL)
+        return false;
+      ofs += page_read_bytes;
+#else
       /* Get a page of memory. */
       uint8_t *kpage = palloc_get_page (PAL_USER);
       if (kpage == NULL)
@@ -583,6 +742,7 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
           palloc_free_page (kpage);
           return false; 
         }
+#endif
 
       /* Advance. */
       read_bytes -= page_read_bytes;
@@ -597,8 +757,15 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 static bool
 setup_stack (void **esp) 
 {
-  uint8_t *kpage;
   bool success = false;
+#ifdef VM
+  struct page *p = page_add_zero (((uint8_t *) PHYS_BASE) - PGSIZE, true);
+
+  success = p != NULL && page_in (p);
+  if (success)
+    *esp = PHYS_BASE - 12;
+#else
+  uint8_t *kpage;
 
   kpage = palloc_get_page (PAL_USER | PAL_ZERO);
   if (kpage != NULL) 
@@ -612,9 +779,11 @@ setup_stack (void **esp)
       else
         palloc_free_page (kpage);
     }
+#endif
   return success;
 }
 
+#ifndef VM
 /* Adds a mapping from user virtual address UPAGE to kernel
    virtual address KPAGE to the page table.
    If WRITABLE is true, the user process may modify the page;
@@ -634,3 +803,4 @@ install_page (void *upage, void *kpage, bool writable)
   return (pagedir_get_page (t->pagedir, upage) == NULL
           && pagedir_set_page (t->pagedir, upage, kpage, writable));
 }
+#endif
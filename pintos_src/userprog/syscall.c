@@ -1,5 +1,6 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
@@ -11,10 +12,16 @@
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "threads/palloc.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
 #include "devices/input.h"
+#include "devices/intq.h"
 #include "threads/synch.h"
 #include "userprog/pagedir.h"
+#include "userprog/futex.h"
+#ifdef VM
+#include "vm/mmap.h"
+#include "vm/page.h"
+#endif
 
 static void syscall_handler (struct intr_frame *);
 
@@ -23,7 +30,7 @@ void debug_(int *t);
 typedef int pid_t;
 int sys_close (int fd);
 int sys_write (int fd, const void *buffer, unsigned length);
-static struct lock fl_lock;
+static struct rwlock fl_lock;
 static struct file *search_file (int fd);
 void debug_(int *t);
 void validate_address (void *address);
@@ -35,13 +42,17 @@ struct file_descriptor
     struct list_elem thread_elem;
 };  
 static struct list fl_list;
+static struct kmem_cache fd_cache;
 
 void
 syscall_init (void) 
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
   list_init (&fl_list);
-  lock_init (&fl_lock);
+  rwlock_init (&fl_lock);
+  futex_init ();
+  kmem_cache_init (&fd_cache, "file_descriptor",
+                   sizeof (struct file_descriptor), NULL);
 }
 
 void debug_(int *t)
@@ -70,7 +81,7 @@ sys_close(int fd)
         file_close (fl->file);
         list_remove (&fl->elem);
         list_remove (&fl->thread_elem);
-        free (fl);
+        kmem_cache_free (&fd_cache, fl);
         break;
       }
   } 
@@ -104,6 +115,9 @@ static void
 syscall_handler (struct intr_frame *f) 
 {
   int *p = f->esp;
+#ifdef VM
+  thread_current ()->user_esp = f->esp;
+#endif
   validate_address (f->esp);
   switch(*p)
   {
@@ -125,9 +139,9 @@ syscall_handler (struct intr_frame *f)
         }
         char *cmd=(char*)*(p+1);
         if (!cmd || !is_user_vaddr (cmd)) f->eax = -1;
-        lock_acquire (&fl_lock);
+        rwlock_acquire_write (&fl_lock);
         f->eax = process_execute (cmd);
-        lock_release (&fl_lock);
+        rwlock_release_write (&fl_lock);
         break;
     }
     case SYS_WAIT:
@@ -150,20 +164,20 @@ syscall_handler (struct intr_frame *f)
     	  const void *buffer=*(p+6);
     	  unsigned length=*(p+7);
 		  int ret = -1;
-		  lock_acquire (&fl_lock);
+		  rwlock_acquire_write (&fl_lock);
 		  if (fd == STDOUT_FILENO)
 		  { 
 		    putbuf (buffer, length);
 		  }
 		  else if (fd == STDIN_FILENO) 
 		  {
-		      lock_release (&fl_lock);
+		      rwlock_release_write (&fl_lock);
 			  f->eax = ret;
 	          break;
 		  }
 		  else if (!is_user_vaddr (buffer) || !is_user_vaddr (buffer + length))
 		  {
-		      lock_release (&fl_lock);
+		      rwlock_release_write (&fl_lock);
 		      sys_exit (-1);
 		  }
 		  else
@@ -171,13 +185,25 @@ syscall_handler (struct intr_frame *f)
 		      fl = search_file (fd);
 		      if (!fl)
 		      {
-		          lock_release (&fl_lock);
+		          rwlock_release_write (&fl_lock);
 				  f->eax = ret;
 		          break;
 		      }
+#ifdef VM
+		      /* Keep the buffer in memory, so that the disk driver
+		         doesn't fault on it while holding its lock. */
+		      if (!page_pin_range (buffer, length, false))
+		      {
+		          rwlock_release_write (&fl_lock);
+		          sys_exit (-1);
+		      }
+#endif
 		      ret = file_write (fl, buffer, length);
+#ifdef VM
+		      page_unpin_range (buffer, length);
+#endif
 		  }   
-		  lock_release (&fl_lock);
+		  rwlock_release_write (&fl_lock);
 		  f->eax = ret;
           break;
     }
@@ -196,10 +222,10 @@ syscall_handler (struct intr_frame *f)
 		       break;
 		  }
 		  if (!is_user_vaddr (*(p+1))) sys_exit(-1);	
-		  lock_acquire(&fl_lock);  
+		  rwlock_acquire_write (&fl_lock);  
 		  fe = filesys_open (*(p+1));
 		  if (!fe) goto done1;
-		  desc = (struct file_descriptor *)malloc(sizeof(struct file_descriptor));
+		  desc = kmem_cache_alloc (&fd_cache);
 		  if (!desc) 
 		  {
 		      file_close(fe);
@@ -211,7 +237,7 @@ syscall_handler (struct intr_frame *f)
 		  list_push_back (&thread_current()->files, &desc->thread_elem);
 		  ret = desc->fd;
 		  done1:
-		  lock_release (&fl_lock);
+		  rwlock_release_write (&fl_lock);
 		  f->eax = ret;
 		  break;
     }
@@ -222,7 +248,7 @@ syscall_handler (struct intr_frame *f)
 	           sys_exit (-1);
 	      }
     	  struct file *fl;
-    	  lock_acquire (&fl_lock);
+    	  rwlock_acquire_read (&fl_lock);
 		  fl = search_file (*(p+1));
 		  if (!fl)
 		  {
@@ -232,7 +258,7 @@ syscall_handler (struct intr_frame *f)
 		  {
 		  		f->eax=file_length (fl);
 		  }
-		  lock_release (&fl_lock);
+		  rwlock_release_read (&fl_lock);
 		  break;
     }
     case SYS_CREATE:
@@ -244,9 +270,9 @@ syscall_handler (struct intr_frame *f)
     	  if (!*(p+4)) sys_exit(-1);
 		  else
 		  {
-		  	    lock_acquire (&fl_lock);
+		  	    rwlock_acquire_write (&fl_lock);
 		  		f->eax = filesys_create (*(p+4), *(p+5));
-		  		lock_release (&fl_lock);
+		  		rwlock_release_write (&fl_lock);
 		  }
 		  break;
     } 
@@ -263,9 +289,9 @@ syscall_handler (struct intr_frame *f)
 	  	}
 		else
 		{
-     		lock_acquire (&fl_lock);
+     		rwlock_acquire_write (&fl_lock);
 			f->eax=filesys_remove (*(p+1));
-			lock_release (&fl_lock);
+			rwlock_release_write (&fl_lock);
 		} 
 	  	break;
     }
@@ -279,26 +305,34 @@ syscall_handler (struct intr_frame *f)
     	void *buffer=*(p+6);
     	unsigned size=*(p+7);
 		struct file * fl;
-		unsigned i;
+		uint8_t keys[INTQ_BUFSIZE];
+		unsigned i, n;
 		int ret = -1; 
-		lock_acquire (&fl_lock);
+		rwlock_acquire_read (&fl_lock);
 		if (fd == STDIN_FILENO) 
 		{
-		      for (i = 0; i != size; ++i) *(uint8_t *)(buffer + i) = input_getc ();
+		      /* Read keys into a kernel buffer a chunk at a time, so that
+		         user memory is only touched with interrupts on. */
+		      for (i = 0; i != size; i += n)
+		      {
+		          n = size - i < sizeof keys ? size - i : sizeof keys;
+		          input_read (keys, n);
+		          memcpy (buffer + i, keys, n);
+		      }
 		      ret = size;
-		      lock_release (&fl_lock);
+		      rwlock_release_read (&fl_lock);
 			  f->eax=ret;
 			  break;
 		}
 		else if (fd == STDOUT_FILENO)
 		{
-			  lock_release (&fl_lock);
+			  rwlock_release_read (&fl_lock);
 			  f->eax=ret;
 			  break;
 		}
 		else if (!is_user_vaddr (buffer) || !is_user_vaddr (buffer + size)) 
 		{
-		      lock_release (&fl_lock);
+		      rwlock_release_read (&fl_lock);
 		      sys_exit (-1);
 		}
 		else
@@ -306,13 +340,23 @@ syscall_handler (struct intr_frame *f)
 		      fl = search_file (fd);
 		      if (!fl)
 		      {
-		      	  lock_release (&fl_lock);
+		      	  rwlock_release_read (&fl_lock);
 				  f->eax=ret;
 				  break;
 		      }
+#ifdef VM
+		      if (!page_pin_range (buffer, size, true))
+		      {
+		          rwlock_release_read (&fl_lock);
+		          sys_exit (-1);
+		      }
+#endif
 		      ret = file_read (fl, buffer, size);
+#ifdef VM
+		      page_unpin_range (buffer, size);
+#endif
 		}  
-		lock_release (&fl_lock);
+		rwlock_release_read (&fl_lock);
 		f->eax=ret;
 		break;
     }
@@ -322,11 +366,71 @@ syscall_handler (struct intr_frame *f)
 	    {
 	          f->eax = sys_exit (-1);
 	    }
-	    lock_acquire(&fl_lock);
+	    rwlock_acquire_write (&fl_lock);
 	    f->eax = sys_close(*(p+1));
-	    lock_release(&fl_lock);
+	    rwlock_release_write (&fl_lock);
 	    break;
     }
+    case SYS_FUTEX_WAIT:
+    {
+        if (!(is_user_vaddr (p + 1) && is_user_vaddr (p + 2) && is_user_vaddr (p + 3)))
+        {
+           sys_exit (-1);
+        }
+        int ret = futex_wait ((int *) *(p + 1), *(p + 2), *(p + 3));
+        if (ret < 0)
+           sys_exit (-1);
+        f->eax = ret;
+        break;
+    }
+    case SYS_FUTEX_WAKE:
+    {
+        if (!is_user_vaddr (p + 1) || !is_user_vaddr (p + 2))
+        {
+           sys_exit (-1);
+        }
+        int ret = futex_wake ((int *) *(p + 1), *(p + 2));
+        if (ret < 0)
+           sys_exit (-1);
+        f->eax = ret;
+        break;
+    }
+    case SYS_FORK:
+    {
+        f->eax = process_fork (f);
+        break;
+    }
+#ifdef VM
+    case SYS_MMAP:
+    {
+        if (!is_user_vaddr (p + 1) || !is_user_vaddr (p + 2))
+        {
+           sys_exit (-1);
+        }
+        struct file *fl;
+        int ret = MAP_FAILED;
+        rwlock_acquire_read (&fl_lock);
+        fl = search_file (*(p + 1));
+        if (fl != NULL)
+           ret = mmap_map (fl, (void *) *(p + 2));
+        rwlock_release_read (&fl_lock);
+        f->eax = ret;
+        break;
+    }
+    case SYS_MUNMAP:
+    {
+        if (!is_user_vaddr (p + 1))
+        {
+           sys_exit (-1);
+        }
+        /* Unmapping writes modified pages back to the file, so
+           keep other writes to it out, as for SYS_WRITE. */
+        rwlock_acquire_write (&fl_lock);
+        mmap_unmap (*(p + 1));
+        rwlock_release_write (&fl_lock);
+        break;
+    }
+#endif
     default:
     {
       sys_exit(-1);
@@ -338,18 +442,69 @@ syscall_handler (struct intr_frame *f)
 
 void validate_address (void *address)
 {
+#ifdef VM
+  /* The page may be swapped out, or not yet touched; reading it
+     faults it in. */
+  if (address == NULL || is_kernel_vaddr (address) || page_lookup (address) == NULL) sys_exit (-1);
+#else
   if (address == NULL || is_kernel_vaddr (address)||pagedir_get_page (thread_current ()->pagedir, address) == NULL) sys_exit (-1);
+#endif
 }
 
+/* Returns the running process's file open as FD, or a null
+   pointer if it has none.  A forked child shares its parent's
+   descriptor numbers, so only the process's own list is
+   searched. */
 static struct file *search_file (int fd)
 {
+  struct thread *t = thread_current ();
   struct file_descriptor *ret;
   struct list_elem *l;
-  for (l = list_begin (&fl_list); l != list_end (&fl_list); l = list_next (l))
+  for (l = list_begin (&t->files); l != list_end (&t->files); l = list_next (l))
   {
-      ret = list_entry (l, struct file_descriptor, elem);
+      ret = list_entry (l, struct file_descriptor, thread_elem);
       if (ret->fd == fd) return ret->file;
   } 
   return NULL;
 }
 
+/* Gives the running process its own copy of each of PARENT's
+   open files, under the same descriptor numbers and at the same
+   positions.  Returns true if successful, false if memory ran
+   out; the files copied so far are then left open, for
+   sys_exit() to close. */
+bool
+syscall_copy_files (struct thread *parent) 
+{
+  struct thread *t = thread_current ();
+  struct list_elem *l;
+  bool success = true;
+
+  rwlock_acquire_write (&fl_lock);
+  for (l = list_begin (&parent->files); l != list_end (&parent->files);
+       l = list_next (l))
+    {
+      struct file_descriptor *pd = list_entry (l, struct file_descriptor,
+                                               thread_elem);
+      struct file_descriptor *desc = kmem_cache_alloc (&fd_cache);
+      if (desc == NULL)
+        {
+          success = false;
+          break;
+        }
+      desc->file = file_reopen (pd->file);
+      if (desc->file == NULL)
+        {
+          kmem_cache_free (&fd_cache, desc);
+          success = false;
+          break;
+        }
+      file_seek (desc->file, file_tell (pd->file));
+      desc->fd = pd->fd;
+      list_push_back (&fl_list, &desc->elem);
+      list_push_back (&t->files, &desc->thread_elem);
+    }
+  rwlock_release_write (&fl_lock);
+  return success;
+}
+
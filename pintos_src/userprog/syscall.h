@@ -1,7 +1,12 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include <stdbool.h>
+
+struct thread;
+
 void syscall_init (void);
 int sys_exit (int status);
+bool syscall_copy_files (struct thread *parent);
 
 #endif /* userprog/syscall.h */
@@ -0,0 +1,189 @@
+#include "vm/frame.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/slab.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "vm/page.h"
+
+/* Frame table.
+
+   Every page of the user pool that holds a user page has a
+   `struct frame' in the frame table.  When the user pool runs
+   out, frame_alloc() evicts the pages in some other frame and
+   reuses the frame.
+
+   The victim is chosen by the clock (second chance) algorithm:
+   the hand sweeps around the frame table, skipping pinned frames
+   and clearing the accessed bits of frames whose pages were used
+   since the last sweep, and stops at the first frame whose pages
+   were not.
+
+   The frame lock protects the frame table, the pin counts, and
+   the link between each page and its frame in every process.
+   Eviction writes the victim out with the lock held, so a
+   process that faults on a page being evicted waits for the
+   page to reach swap before bringing it back.  Filling a newly
+   allocated frame happens without the lock; the frame stays
+   pinned meanwhile so that it cannot be evicted half-filled. */
+
+static struct list frames;              /* All frames. */
+static struct list_elem *hand;          /* Clock hand, in `frames'. */
+static size_t frame_cnt;                /* Number of frames. */
+static struct lock frame_lock;          /* Protects frames. */
+static struct kmem_cache frame_cache;   /* Cache of `struct frame's. */
+
+/* Statistics. */
+static size_t peak_cnt;                 /* Maximum of frame_cnt. */
+static long long evict_cnt;             /* Frames reused by eviction. */
+static long long sweep_cnt;             /* Frames passed by clock hand. */
+
+static struct frame *evict (void);
+static bool accessed (struct frame *);
+
+/* Initializes the frame table. */
+void
+frame_init (void) 
+{
+  list_init (&frames);
+  hand = list_end (&frames);
+  lock_init (&frame_lock);
+  kmem_cache_init (&frame_cache, "frame", sizeof (struct frame), NULL);
+}
+
+/* Obtains a frame, evicting the pages in another frame if the
+   user pool is empty, and returns it pinned and holding no
+   pages.  If PAL_ZERO is set in FLAGS, the frame is zeroed.
+   Returns a null pointer if no frame can be freed. */
+struct frame *
+frame_alloc (enum palloc_flags flags) 
+{
+  struct frame *f = NULL;
+  void *kpage;
+
+  lock_acquire (&frame_lock);
+  kpage = palloc_get_page (PAL_USER | flags);
+  if (kpage != NULL) 
+    {
+      f = kmem_cache_alloc (&frame_cache);
+      if (f == NULL)
+        palloc_free_page (kpage);
+      else 
+        {
+          f->kpage = kpage;
+          list_insert (hand, &f->elem);
+          if (++frame_cnt > peak_cnt)
+            peak_cnt = frame_cnt;
+        }
+    }
+  else 
+    {
+      f = evict ();
+      if (f != NULL && (flags & PAL_ZERO))
+        memset (f->kpage, 0, PGSIZE);
+    }
+  if (f != NULL) 
+    {
+      list_init (&f->pages);
+      f->pin_cnt = 1;
+      f->inode = NULL;
+    }
+  lock_release (&frame_lock);
+
+  return f;
+}
+
+/* Removes F, which must hold no pages, from the frame table and
+   frees its page.  The frame lock must be held. */
+void
+frame_free (struct frame *f) 
+{
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+  ASSERT (list_empty (&f->pages));
+  ASSERT (f->inode == NULL);
+
+  if (hand == &f->elem)
+    hand = list_next (hand);
+  list_remove (&f->elem);
+  frame_cnt--;
+  palloc_free_page (f->kpage);
+  kmem_cache_free (&frame_cache, f);
+}
+
+/* Acquires the frame lock. */
+void
+frame_lock_acquire (void) 
+{
+  lock_acquire (&frame_lock);
+}
+
+/* Releases the frame lock. */
+void
+frame_lock_release (void) 
+{
+  lock_release (&frame_lock);
+}
+
+/* Prints frame table statistics. */
+void
+frame_print_stats (void) 
+{
+  printf ("Frames: %zu in use, %zu peak, %lld evictions, "
+          "%lld frames swept\n",
+          frame_cnt, peak_cnt, evict_cnt, sweep_cnt);
+}
+
+/* Chooses a victim frame by the clock algorithm, writes its page
+   out, and returns it.  Returns a null pointer if every frame is
+   pinned or no page can be written out.  The frame lock must be
+   held. */
+static struct frame *
+evict (void) 
+{
+  size_t i;
+
+  /* Two full sweeps clear every accessed bit and then visit
+     every frame with the bit clear. */
+  for (i = 0; i < 2 * frame_cnt; i++) 
+    {
+      struct frame *f;
+
+      if (hand == list_end (&frames))
+        hand = list_begin (&frames);
+      f = list_entry (hand, struct frame, elem);
+      hand = list_next (hand);
+      sweep_cnt++;
+
+      if (f->pin_cnt == 0 && !accessed (f) && page_out (f))
+        {
+          evict_cnt++;
+          return f;
+        }
+    }
+  return NULL;
+}
+
+/* Returns true if any page in F was accessed since the last
+   call, and clears their accessed bits. */
+static bool
+accessed (struct frame *f) 
+{
+  struct list_elem *e;
+  bool result = false;
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages); e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      uint32_t *pd = p->owner->pagedir;
+
+      if (pagedir_is_accessed (pd, p->upage)) 
+        {
+          pagedir_set_accessed (pd, p->upage, false);
+          result = true;
+        }
+    }
+  return result;
+}
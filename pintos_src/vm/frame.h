@@ -0,0 +1,40 @@
+#ifndef VM_FRAME_H
+#define VM_FRAME_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include "filesys/off_t.h"
+#include "threads/palloc.h"
+
+/* A frame: a page of the user pool holding a user page.
+
+   A frame may hold a page of several processes.  After fork,
+   parent and child share their pages' frames copy-on-write:
+   such a frame is mapped read-only in all of them until each
+   one that writes to it gets a copy.  Processes that map the
+   same page of a file with mmap() share its frame for good, so
+   that they see each other's writes. */
+struct frame
+  {
+    void *kpage;                /* Kernel virtual address. */
+    struct list pages;          /* Pages held, all with the same contents. */
+    int pin_cnt;                /* Nonzero: may not be evicted. */
+    struct list_elem elem;      /* Element in frame table. */
+
+    /* For a frame holding a page of a mapped file (vm/page.c). */
+    struct inode *inode;        /* File mapped, or null. */
+    off_t ofs;                  /* Offset of the page in the file. */
+    struct hash_elem map_elem;  /* Element in mapped frame table. */
+  };
+
+void frame_init (void);
+struct frame *frame_alloc (enum palloc_flags);
+void frame_free (struct frame *);
+
+void frame_lock_acquire (void);
+void frame_lock_release (void);
+
+void frame_print_stats (void);
+
+#endif /* vm/frame.h */
@@ -0,0 +1,162 @@
+#include "vm/mmap.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "vm/page.h"
+
+/* Memory-mapped files.
+
+   A mapping adds one PAGE_MMAP page per page of the file to the
+   process's supplemental page table.  Pages are read straight
+   from the file into their frames on first touch, with no copy
+   through a user buffer, and are written back only if they were
+   modified, when they are evicted or unmapped.  A page already
+   in memory because another process maps the same file is not
+   read again: the processes share its frame.  Each mapping
+   holds its own reopened file, so it stays valid after the
+   process closes the descriptor it was made from, or removes
+   the file. */
+
+/* A memory-mapped file. */
+struct mapping
+  {
+    mapid_t id;                 /* Mapping identifier. */
+    struct file *file;          /* File mapped. */
+    uint8_t *base;              /* First mapped page. */
+    size_t page_cnt;            /* Number of mapped pages. */
+    struct list_elem elem;      /* Element in thread's `mappings'. */
+  };
+
+static struct mapping *find_mapping (mapid_t);
+static void unmap (struct mapping *);
+
+/* Initializes the current thread's list of mappings. */
+void
+mmap_table_init (void) 
+{
+  struct thread *t = thread_current ();
+
+  list_init (&t->mappings);
+  t->next_mapid = 0;
+}
+
+/* Maps FILE into the current process's address space starting
+   at ADDR, which must be page-aligned and nonzero.  Fails if
+   FILE is empty or any page of the mapping is already in use,
+   including by code, data, or the stack.  Returns the new
+   mapping's identifier, or MAP_FAILED on failure. */
+mapid_t
+mmap_map (struct file *file, void *addr) 
+{
+  struct thread *t = thread_current ();
+  struct mapping *m;
+  off_t length;
+  size_t i;
+
+  length = file_length (file);
+  if (addr == NULL || pg_ofs (addr) != 0 || length == 0)
+    return MAP_FAILED;
+  if (!is_user_vaddr (addr)
+      || (uintptr_t) addr + length < (uintptr_t) addr
+      || !is_user_vaddr ((uint8_t *) addr + length)
+      || page_is_stack ((uint8_t *) addr + length - 1))
+    return MAP_FAILED;
+
+  m = malloc (sizeof *m);
+  if (m == NULL)
+    return MAP_FAILED;
+  m->file = file_reopen (file);
+  if (m->file == NULL) 
+    {
+      free (m);
+      return MAP_FAILED;
+    }
+  m->base = addr;
+  m->page_cnt = DIV_ROUND_UP (length, PGSIZE);
+
+  for (i = 0; i < m->page_cnt; i++) 
+    {
+      off_t ofs = i * PGSIZE;
+      uint32_t read_bytes = length - ofs < PGSIZE ? length - ofs : PGSIZE;
+
+      if (page_add_mmap (m->base + ofs, m->file, ofs, read_bytes) == NULL) 
+        {
+          /* Back out the pages added so far. */
+          m->page_cnt = i;
+          unmap (m);
+          return MAP_FAILED;
+        }
+    }
+
+  m->id = t->next_mapid++;
+  list_push_back (&t->mappings, &m->elem);
+  return m->id;
+}
+
+/* Unmaps mapping ID of the current process, writing modified
+   pages back to the file.  Does nothing if there is no such
+   mapping. */
+void
+mmap_unmap (mapid_t id) 
+{
+  struct mapping *m = find_mapping (id);
+
+  if (m != NULL) 
+    {
+      list_remove (&m->elem);
+      unmap (m);
+    }
+}
+
+/* Unmaps all of the current process's mappings.  Called at
+   process exit, before the page table is destroyed. */
+void
+mmap_unmap_all (void) 
+{
+  struct thread *t = thread_current ();
+
+  while (!list_empty (&t->mappings)) 
+    {
+      struct list_elem *e = list_pop_front (&t->mappings);
+      unmap (list_entry (e, struct mapping, elem));
+    }
+}
+
+/* Returns the current process's mapping with the given ID, or a
+   null pointer if there is none. */
+static struct mapping *
+find_mapping (mapid_t id) 
+{
+  struct thread *t = thread_current ();
+  struct list_elem *e;
+
+  for (e = list_begin (&t->mappings); e != list_end (&t->mappings);
+       e = list_next (e)) 
+    {
+      struct mapping *m = list_entry (e, struct mapping, elem);
+      if (m->id == id)
+        return m;
+    }
+  return NULL;
+}
+
+/* Removes M's pages, writing back those that were modified,
+   closes its file, and frees it.  M must not be in a list. */
+static void
+unmap (struct mapping *m) 
+{
+  size_t i;
+
+  for (i = 0; i < m->page_cnt; i++) 
+    {
+      struct page *p = page_lookup (m->base + i * PGSIZE);
+      ASSERT (p != NULL && p->type == PAGE_MMAP && p->file == m->file);
+      page_remove (p);
+    }
+  file_close (m->file);
+  free (m);
+}
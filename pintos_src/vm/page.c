@@ -0,0 +1,827 @@
+#include "vm/page.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "vm/frame.h"
+#include "vm/swap.h"
+
+/* Demand paging.
+
+   A process's pages are not allocated or read when it is
+   loaded.  Instead, load() records each page of each segment in
+   the process's supplemental page table, and the page fault
+   handler brings a page in the first time the process (or the
+   kernel, on the process's behalf) touches it.  Pages of an
+   executable that are never used are thus never read, and a
+   large program starts as quickly as a small one.
+
+   Each page table belongs to a single process, and only that
+   process's thread adds, removes, or brings in its pages.
+   Eviction, on behalf of any process, may write a page out at
+   any time the page's frame is not pinned.  The link between a
+   page and its frame is therefore only examined or changed with
+   the frame lock held (see vm/frame.c).
+
+   fork() copies a page table lazily.  Parent and child share
+   each page in memory, mapped read-only in both, and each
+   swapped-out page's swap slot.  The first write to a shared
+   page faults, and page_unshare() gives the writer its own copy.
+   Memory-mapped files are not inherited.
+
+   Processes that map the same file share each of its pages that
+   is in memory: mapped_frames indexes the frames of mapped pages
+   by inode and offset, and a process bringing in a mapped page
+   joins the frame already holding it, if any.  The processes
+   thus see each other's writes at once, and can synchronize
+   with futexes in the shared pages.
+
+   A process starts with one page of stack.  The stack grows on
+   demand: a touch of a missing page in the stack region, from
+   PHYS_BASE down to page_stack_limit pages below it, adds a
+   zero page there if it is no more than 32 bytes below the user
+   stack pointer, as far as PUSHA reaches.  Anything further down
+   is a stray access.  When the kernel touches user memory, it
+   judges by the stack pointer saved at entry to the system
+   call. */
+
+/* Maximum size of a user stack, in pages. */
+size_t page_stack_limit = 2048;
+
+/* Cache of `struct page's. */
+static struct kmem_cache page_cache;
+
+/* Frames holding pages of mapped files, by inode and offset.
+   Protected by the frame lock. */
+static struct hash mapped_frames;
+
+/* Statistics. */
+static long long file_loads;    /* Pages read from files. */
+static long long zero_fills;    /* Pages zero-filled on first touch. */
+static long long clean_drops;   /* Clean file pages evicted without I/O. */
+static long long write_backs;   /* Dirty mapped pages written to files. */
+static long long cow_shares;    /* Frames shared by fork. */
+static long long cow_copies;    /* Shared frames copied on write. */
+static long long mapped_shares; /* Mapped pages found in another's frame. */
+static long long stack_grows;   /* Stack pages added on demand. */
+
+static hash_hash_func page_hash;
+static hash_less_func page_less;
+static hash_action_func page_destroy;
+static struct page *page_add (void *upage, enum page_type, bool writable);
+static bool load_page (struct page *, bool pin);
+static void write_back (struct page *);
+static bool is_shared (struct frame *);
+static struct page *find_page (const void *uaddr);
+static bool link_page (struct page *, struct frame *);
+static struct frame *mapped_find (struct page *);
+static void mapped_insert (struct frame *, struct page *);
+static void mapped_remove (struct frame *);
+static hash_hash_func mapped_hash;
+static hash_less_func mapped_less;
+
+/* Initializes the demand pager. */
+void
+page_init (void) 
+{
+  kmem_cache_init (&page_cache, "page", sizeof (struct page), NULL);
+  if (!hash_init (&mapped_frames, mapped_hash, mapped_less, NULL))
+    PANIC ("page_init: out of memory");
+}
+
+/* Initializes the current thread's supplemental page table.
+   Returns true if successful, false on failure. */
+bool
+page_table_init (void) 
+{
+  return hash_init (&thread_current ()->pages, page_hash, page_less, NULL);
+}
+
+/* Copies PARENT's supplemental page table, except its
+   memory-mapped files, into the current thread's, which must be
+   empty.  Pages in memory are shared copy-on-write: they are
+   mapped read-only in both processes.  Swapped-out pages share
+   their swap slots, and the rest are copied as is.  PARENT must
+   not run meanwhile, and the current thread's image file must
+   already be open.  Returns true if successful, false if memory
+   is short. */
+bool
+page_table_copy (struct thread *parent) 
+{
+  struct thread *t = thread_current ();
+  struct hash_iterator i;
+  bool success = true;
+
+  frame_lock_acquire ();
+  hash_first (&i, &parent->pages);
+  while (hash_next (&i)) 
+    {
+      struct page *pp = hash_entry (hash_cur (&i), struct page, elem);
+      struct page *p;
+
+      if (pp->type == PAGE_MMAP)
+        continue;
+
+      p = page_add (pp->upage, pp->type, pp->writable);
+      if (p == NULL) 
+        {
+          success = false;
+          break;
+        }
+      p->file = pp->type == PAGE_FILE ? t->self : NULL;
+      p->ofs = pp->ofs;
+      p->read_bytes = pp->read_bytes;
+
+      if (pp->frame != NULL) 
+        {
+          struct frame *f = pp->frame;
+
+          if (!pagedir_set_page (t->pagedir, p->upage, f->kpage, false)) 
+            {
+              success = false;
+              break;
+            }
+          pagedir_set_dirty (t->pagedir, p->upage,
+                             pagedir_is_dirty (parent->pagedir, pp->upage));
+          pagedir_set_writable (parent->pagedir, pp->upage, false);
+          p->frame = f;
+          list_push_back (&f->pages, &p->frame_elem);
+          cow_shares++;
+        }
+      else if (pp->swap_slot != SWAP_ERROR) 
+        {
+          swap_dup (pp->swap_slot);
+          p->swap_slot = pp->swap_slot;
+        }
+    }
+  frame_lock_release ();
+
+  return success;
+}
+
+/* Destroys the current thread's supplemental page table, freeing
+   the frames and swap slots of its pages.  Must be called before
+   the thread's page directory is destroyed. */
+void
+page_table_destroy (void) 
+{
+  hash_destroy (&thread_current ()->pages, page_destroy);
+}
+
+/* Adds a page at UPAGE to the current thread's supplemental page
+   table whose first READ_BYTES bytes come from FILE starting at
+   offset OFS.  The rest of the page is zeroed.  FILE must stay
+   open while the page exists.  Returns the new page, or a null
+   pointer if UPAGE is already in use or memory is short. */
+struct page *
+page_add_file (void *upage, struct file *file, off_t ofs,
+               uint32_t read_bytes, bool writable) 
+{
+  struct page *p;
+
+  ASSERT (read_bytes <= PGSIZE);
+
+  p = page_add (upage, PAGE_FILE, writable);
+  if (p != NULL) 
+    {
+      p->file = file;
+      p->ofs = ofs;
+      p->read_bytes = read_bytes;
+    }
+  return p;
+}
+
+/* Adds an all-zero page at UPAGE to the current thread's
+   supplemental page table.  Returns the new page, or a null
+   pointer if UPAGE is already in use or memory is short. */
+struct page *
+page_add_zero (void *upage, bool writable) 
+{
+  return page_add (upage, PAGE_ZERO, writable);
+}
+
+/* Adds a page at UPAGE to the current thread's supplemental page
+   table that maps READ_BYTES bytes of FILE starting at offset
+   OFS.  The rest of the page is zeroed when it is read and is
+   not written back.  Changes to the page are written back to
+   FILE when it is evicted or removed.  FILE must stay open while
+   the page exists.  Returns the new page, or a null pointer if
+   UPAGE is already in use or memory is short. */
+struct page *
+page_add_mmap (void *upage, struct file *file, off_t ofs,
+               uint32_t read_bytes) 
+{
+  struct page *p;
+
+  ASSERT (read_bytes <= PGSIZE);
+
+  p = page_add (upage, PAGE_MMAP, true);
+  if (p != NULL) 
+    {
+      p->file = file;
+      p->ofs = ofs;
+      p->read_bytes = read_bytes;
+    }
+  return p;
+}
+
+/* Removes page P from the current thread's supplemental page
+   table, writing it back first if it is a modified mapped page,
+   and frees it. */
+void
+page_remove (struct page *p) 
+{
+  ASSERT (p->owner == thread_current ());
+
+  hash_delete (&p->owner->pages, &p->elem);
+  page_destroy (&p->elem, NULL);
+}
+
+/* Returns the page containing user address UADDR in the current
+   thread's supplemental page table, or a null pointer if there
+   is none. */
+struct page *
+page_lookup (const void *uaddr) 
+{
+  struct page p;
+  struct hash_elem *e;
+
+  p.upage = pg_round_down (uaddr);
+  e = hash_find (&thread_current ()->pages, &p.elem);
+  return e != NULL ? hash_entry (e, struct page, elem) : NULL;
+}
+
+/* Returns true if user address UADDR lies in the region
+   reserved for the user stack, false otherwise. */
+bool
+page_is_stack (const void *uaddr) 
+{
+  return ((uintptr_t) PHYS_BASE - (uintptr_t) uaddr
+          <= page_stack_limit * PGSIZE
+          && is_user_vaddr (uaddr));
+}
+
+/* Brings page P of the current thread into memory, if it is not
+   already, and maps it in the thread's page directory.  Returns
+   true if successful, false if no frame can be found or the file
+   cannot be read. */
+bool
+page_in (struct page *p) 
+{
+  return load_page (p, false);
+}
+
+/* Brings in the page containing user address UADDR for the
+   current thread, if it has one, growing the stack to cover
+   UADDR if need be.  Returns true if successful, false if UADDR
+   is not part of the address space or the page cannot be
+   brought in. */
+bool
+page_fault_in (const void *uaddr) 
+{
+  struct page *p = find_page (uaddr);
+
+  return p != NULL && load_page (p, false);
+}
+
+/* Makes the current thread's page containing user address
+   UADDR writable in its page directory, first giving the thread
+   a copy of the page if it shares the page's frame with another
+   process.  Returns true if successful, false if UADDR is not in
+   a writable page or memory is short.  Called on a write to a
+   page that fork() made read-only. */
+bool
+page_unshare (const void *uaddr) 
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  struct page *p;
+  struct frame *f, *copy;
+  bool dirty;
+
+  if (!is_user_vaddr (uaddr))
+    return false;
+  p = page_lookup (uaddr);
+  if (p == NULL || !p->writable)
+    return false;
+
+  frame_lock_acquire ();
+  f = p->frame;
+  if (f == NULL || !is_shared (f) || p->type == PAGE_MMAP) 
+    {
+      /* A page that is not in memory comes back in a frame of
+         its own, one whose sharers are gone needs no copy, and a
+         mapped page is meant to be shared. */
+      if (f != NULL)
+        pagedir_set_writable (pd, p->upage, true);
+      frame_lock_release ();
+      return f != NULL || load_page (p, false);
+    }
+  f->pin_cnt++;
+  frame_lock_release ();
+
+  copy = frame_alloc (0);
+  if (copy != NULL)
+    memcpy (copy->kpage, f->kpage, PGSIZE);
+
+  frame_lock_acquire ();
+  f->pin_cnt--;
+  if (copy != NULL) 
+    {
+      dirty = pagedir_is_dirty (pd, p->upage);
+      pagedir_clear_page (pd, p->upage);
+      list_remove (&p->frame_elem);
+      if (list_empty (&f->pages))
+        frame_free (f);
+
+      /* The page table already exists, so this cannot fail. */
+      pagedir_set_page (pd, p->upage, copy->kpage, true);
+      pagedir_set_dirty (pd, p->upage, dirty);
+      p->frame = copy;
+      list_push_back (&copy->pages, &p->frame_elem);
+      copy->pin_cnt--;
+      cow_copies++;
+    }
+  frame_lock_release ();
+
+  return copy != NULL;
+}
+
+/* Brings in the current thread's page containing user address
+   UADDR and pins it in memory until page_unpin().  If WRITE is
+   true, the page must be writable, and the thread gets a private
+   copy of it if it is shared.  Pins nest.  Returns true if
+   successful, false if UADDR is not part of the address space,
+   WRITE is true and the page is read-only, or the page cannot be
+   brought in.
+
+   The kernel pins user buffers it passes to code that may not
+   take a page fault, such as block device drivers that hold a
+   lock. */
+bool
+page_pin (const void *uaddr, bool write) 
+{
+  struct page *p = find_page (uaddr);
+
+  if (p == NULL || (write && !page_unshare (uaddr)))
+    return false;
+  return load_page (p, true);
+}
+
+/* Unpins the current thread's page containing UADDR, which must
+   have been pinned with page_pin(). */
+void
+page_unpin (const void *uaddr) 
+{
+  struct page *p = page_lookup (uaddr);
+
+  ASSERT (p != NULL);
+  frame_lock_acquire ();
+  ASSERT (p->frame != NULL && p->frame->pin_cnt > 0);
+  p->frame->pin_cnt--;
+  frame_lock_release ();
+}
+
+/* Pins each of the current thread's pages that contain any of
+   the SIZE bytes starting at user address UADDR, for writing if
+   WRITE is true.  Returns true if successful.  On failure,
+   returns false with no pages pinned. */
+bool
+page_pin_range (const void *uaddr, size_t size, bool write) 
+{
+  const uint8_t *start = pg_round_down (uaddr);
+  const uint8_t *upage;
+
+  if (size == 0)
+    return true;
+  if ((uintptr_t) uaddr + size < (uintptr_t) uaddr)
+    return false;
+  for (upage = start; upage < (const uint8_t *) uaddr + size; upage += PGSIZE)
+    if (!page_pin (upage, write)) 
+      {
+        while (upage > start)
+          page_unpin (upage -= PGSIZE);
+        return false;
+      }
+  return true;
+}
+
+/* Unpins the pages pinned by page_pin_range(UADDR, SIZE). */
+void
+page_unpin_range (const void *uaddr, size_t size) 
+{
+  const uint8_t *upage;
+
+  if (size == 0)
+    return;
+  for (upage = pg_round_down (uaddr); upage < (const uint8_t *) uaddr + size;
+       upage += PGSIZE)
+    page_unpin (upage);
+}
+
+/* Evicts the pages in frame F on behalf of frame_alloc().  Clean
+   file pages are dropped, to be read again later.  Mapped pages
+   are written back to their files if modified.  Other pages go
+   to swap and become anonymous; pages that shared F share the
+   swap slot.  Returns true if successful, false if swap is full,
+   in which case the pages stay in F.  The frame lock must be
+   held. */
+bool
+page_out (struct frame *f) 
+{
+  struct page *first;
+  struct list_elem *e;
+  size_t slot = SWAP_ERROR;
+  bool dirty = false;
+
+  ASSERT (!list_empty (&f->pages));
+
+  /* Unmap the pages first, so that no owner can modify the frame
+     while it is being written out.  An owner that faults on its
+     page waits for the frame lock. */
+  for (e = list_begin (&f->pages); e != list_end (&f->pages); e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      uint32_t *pd = p->owner->pagedir;
+
+      dirty = dirty || pagedir_is_dirty (pd, p->upage);
+      pagedir_clear_page (pd, p->upage);
+    }
+
+  /* Sharers always have the same type: they are copies made by
+     fork, or mappings of the same page of a file. */
+  first = list_entry (list_front (&f->pages), struct page, frame_elem);
+  if (first->type == PAGE_MMAP)
+    {
+      if (dirty) 
+        {
+          file_write_at (first->file, f->kpage, first->read_bytes,
+                         first->ofs);
+          write_backs++;
+        }
+      mapped_remove (f);
+    }
+  else if (first->type == PAGE_FILE && !dirty)
+    clean_drops++;
+  else
+    {
+      slot = swap_out (f->kpage);
+      if (slot == SWAP_ERROR) 
+        {
+          bool writable = !is_shared (f);
+
+          for (e = list_begin (&f->pages); e != list_end (&f->pages);
+               e = list_next (e))
+            {
+              struct page *p = list_entry (e, struct page, frame_elem);
+              uint32_t *pd = p->owner->pagedir;
+
+              pagedir_set_page (pd, p->upage, f->kpage,
+                                p->writable && writable);
+              pagedir_set_dirty (pd, p->upage, dirty);
+            }
+          return false;
+        }
+    }
+
+  while (!list_empty (&f->pages)) 
+    {
+      struct page *p = list_entry (list_pop_front (&f->pages),
+                                   struct page, frame_elem);
+
+      ASSERT (p->type == first->type);
+      if (slot != SWAP_ERROR) 
+        {
+          if (p != first)
+            swap_dup (slot);
+          p->type = PAGE_ANON;
+          p->swap_slot = slot;
+        }
+      p->frame = NULL;
+    }
+  return true;
+}
+
+/* Prints demand paging statistics. */
+void
+page_print_stats (void) 
+{
+  printf ("Paging: %lld pages read from files, %lld zero-filled, "
+          "%lld clean pages dropped, %lld mapped pages written back\n",
+          file_loads, zero_fills, clean_drops, write_backs);
+  printf ("Copy-on-write: %lld frames shared, %lld copied\n",
+          cow_shares, cow_copies);
+  printf ("Mapped files: %lld pages shared between processes\n",
+          mapped_shares);
+  printf ("Stack: %lld pages added on demand\n", stack_grows);
+}
+
+/* Returns the page containing user address UADDR in the current
+   thread's supplemental page table.  If there is none, but
+   UADDR looks like an access to the stack just below the user
+   stack pointer, adds a zero page for it.  Returns a null
+   pointer if UADDR is not part of the address space or memory
+   is short. */
+static struct page *
+find_page (const void *uaddr) 
+{
+  struct thread *t = thread_current ();
+  struct page *p;
+
+  if (!is_user_vaddr (uaddr))
+    return NULL;
+  p = page_lookup (uaddr);
+  if (p == NULL && page_is_stack (uaddr)
+      && (const uint8_t *) uaddr >= (const uint8_t *) t->user_esp - 32) 
+    {
+      p = page_add_zero (pg_round_down (uaddr), true);
+      if (p != NULL)
+        stack_grows++;
+    }
+  return p;
+}
+
+/* Adds a page of the given TYPE at UPAGE to the current thread's
+   supplemental page table.  Returns the new page, or a null
+   pointer if UPAGE is already in use or memory is short. */
+static struct page *
+page_add (void *upage, enum page_type type, bool writable) 
+{
+  struct page *p;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (is_user_vaddr (upage));
+
+  p = kmem_cache_alloc (&page_cache);
+  if (p == NULL)
+    return NULL;
+  p->upage = upage;
+  p->owner = thread_current ();
+  p->frame = NULL;
+  p->type = type;
+  p->writable = writable;
+  p->file = NULL;
+  p->ofs = 0;
+  p->read_bytes = 0;
+  p->swap_slot = SWAP_ERROR;
+  if (hash_insert (&thread_current ()->pages, &p->elem) != NULL) 
+    {
+      kmem_cache_free (&page_cache, p);
+      return NULL;
+    }
+  return p;
+}
+
+/* Brings page P of the current thread into memory, if it is not
+   already, and maps it.  If PIN is true, also pins its frame.
+   Returns true if successful, false if no frame can be found or
+   the file cannot be read. */
+static bool
+load_page (struct page *p, bool pin) 
+{
+  struct frame *f;
+
+  ASSERT (p->owner == thread_current ());
+
+  frame_lock_acquire ();
+  f = p->frame;
+  if (f == NULL && p->type == PAGE_MMAP) 
+    {
+      /* Another process may have this page of the file in
+         memory already. */
+      f = mapped_find (p);
+      if (f != NULL && !link_page (p, f)) 
+        {
+          frame_lock_release ();
+          return false;
+        }
+    }
+  if (f != NULL && pin)
+    f->pin_cnt++;
+  frame_lock_release ();
+  if (f != NULL)
+    return true;
+
+  /* Only this thread brings P in, and eviction cannot reach P
+     until it has a frame, so P is ours until then.  The new
+     frame is pinned. */
+  f = frame_alloc (p->type == PAGE_ZERO ? PAL_ZERO : 0);
+  if (f == NULL)
+    return false;
+
+  switch (p->type) 
+    {
+    case PAGE_FILE:
+    case PAGE_MMAP:
+      if (file_read_at (p->file, f->kpage, p->read_bytes, p->ofs)
+          != (int) p->read_bytes)
+        goto error;
+      memset ((uint8_t *) f->kpage + p->read_bytes, 0,
+              PGSIZE - p->read_bytes);
+      file_loads++;
+      break;
+
+    case PAGE_ZERO:
+      zero_fills++;
+      break;
+
+    case PAGE_ANON:
+      swap_in (p->swap_slot, f->kpage);
+      p->swap_slot = SWAP_ERROR;
+      break;
+    }
+
+  frame_lock_acquire ();
+  if (p->type == PAGE_MMAP) 
+    {
+      /* Another process may have brought the same page in while
+         we were reading it.  If so, use its frame, which may
+         already have been written to. */
+      struct frame *shared = mapped_find (p);
+      if (shared != NULL) 
+        {
+          frame_free (f);
+          f = shared;
+          f->pin_cnt++;
+        }
+      else
+        mapped_insert (f, p);
+    }
+  if (!link_page (p, f)) 
+    {
+      f->pin_cnt--;
+      if (list_empty (&f->pages)) 
+        {
+          mapped_remove (f);
+          frame_free (f);
+        }
+      frame_lock_release ();
+      return false;
+    }
+
+  /* From now on, a zero page's contents exist only in memory
+     or in swap. */
+  if (p->type == PAGE_ZERO)
+    p->type = PAGE_ANON;
+
+  if (!pin)
+    f->pin_cnt--;
+  frame_lock_release ();
+  return true;
+
+ error:
+  frame_lock_acquire ();
+  frame_free (f);
+  frame_lock_release ();
+  return false;
+}
+
+/* Maps page P of the current thread to frame F and adds it to
+   F's pages.  Returns true if successful, false if memory is
+   short.  The frame lock must be held. */
+static bool
+link_page (struct page *p, struct frame *f) 
+{
+  if (!pagedir_set_page (p->owner->pagedir, p->upage, f->kpage, p->writable))
+    return false;
+  if (!list_empty (&f->pages))
+    mapped_shares++;
+  p->frame = f;
+  list_push_back (&f->pages, &p->frame_elem);
+  return true;
+}
+
+/* Returns the frame holding the page of a file that mapped page
+   P maps, or a null pointer if it is not in memory.  The frame
+   lock must be held. */
+static struct frame *
+mapped_find (struct page *p) 
+{
+  struct frame key;
+  struct hash_elem *e;
+
+  ASSERT (p->type == PAGE_MMAP);
+
+  key.inode = file_get_inode (p->file);
+  key.ofs = p->ofs;
+  e = hash_find (&mapped_frames, &key.map_elem);
+  return e != NULL ? hash_entry (e, struct frame, map_elem) : NULL;
+}
+
+/* Records that frame F holds the page of a file that mapped page
+   P maps.  The frame lock must be held. */
+static void
+mapped_insert (struct frame *f, struct page *p) 
+{
+  ASSERT (f->inode == NULL);
+
+  f->inode = file_get_inode (p->file);
+  f->ofs = p->ofs;
+  hash_insert (&mapped_frames, &f->map_elem);
+}
+
+/* Removes frame F from the mapped frame table, if it is there.
+   The frame lock must be held. */
+static void
+mapped_remove (struct frame *f) 
+{
+  if (f->inode != NULL) 
+    {
+      hash_delete (&mapped_frames, &f->map_elem);
+      f->inode = NULL;
+    }
+}
+
+/* Writes mapped page P, which must be in memory, back to its file
+   if the process modified it.  The frame lock must be held. */
+static void
+write_back (struct page *p) 
+{
+  uint32_t *pd = p->owner->pagedir;
+
+  ASSERT (p->type == PAGE_MMAP);
+  ASSERT (p->frame != NULL);
+
+  if (pagedir_is_dirty (pd, p->upage)) 
+    {
+      file_write_at (p->file, p->frame->kpage, p->read_bytes, p->ofs);
+      pagedir_set_dirty (pd, p->upage, false);
+      write_backs++;
+    }
+}
+
+/* Returns true if more than one page shares frame F. */
+static bool
+is_shared (struct frame *f) 
+{
+  return list_begin (&f->pages) != list_rbegin (&f->pages);
+}
+
+/* Returns a hash value for the page that E refers to. */
+static unsigned
+page_hash (const struct hash_elem *e, void *aux UNUSED) 
+{
+  const struct page *p = hash_entry (e, struct page, elem);
+  return hash_int ((uintptr_t) p->upage >> PGBITS);
+}
+
+/* Returns true if page A precedes page B. */
+static bool
+page_less (const struct hash_elem *a_, const struct hash_elem *b_,
+           void *aux UNUSED) 
+{
+  const struct page *a = hash_entry (a_, struct page, elem);
+  const struct page *b = hash_entry (b_, struct page, elem);
+  return a->upage < b->upage;
+}
+
+/* Returns a hash value for the frame that E refers to. */
+static unsigned
+mapped_hash (const struct hash_elem *e, void *aux UNUSED) 
+{
+  const struct frame *f = hash_entry (e, struct frame, map_elem);
+  return hash_int ((uintptr_t) f->inode ^ (f->ofs >> PGBITS));
+}
+
+/* Returns true if frame A's file page precedes frame B's. */
+static bool
+mapped_less (const struct hash_elem *a_, const struct hash_elem *b_,
+             void *aux UNUSED) 
+{
+  const struct frame *a = hash_entry (a_, struct frame, map_elem);
+  const struct frame *b = hash_entry (b_, struct frame, map_elem);
+  if (a->inode != b->inode)
+    return a->inode < b->inode;
+  return a->ofs < b->ofs;
+}
+
+/* Unmaps the page that E refers to from the current thread's
+   page directory, writes it back if it is a modified mapped page,
+   frees its frame or swap slot, and frees it. */
+static void
+page_destroy (struct hash_elem *e, void *aux UNUSED) 
+{
+  struct page *p = hash_entry (e, struct page, elem);
+
+  frame_lock_acquire ();
+  if (p->frame != NULL) 
+    {
+      if (p->type == PAGE_MMAP)
+        write_back (p);
+      pagedir_clear_page (p->owner->pagedir, p->upage);
+      list_remove (&p->frame_elem);
+      if (list_empty (&p->frame->pages)) 
+        {
+          mapped_remove (p->frame);
+          frame_free (p->frame);
+        }
+    }
+  else if (p->swap_slot != SWAP_ERROR)
+    swap_free (p->swap_slot);
+  frame_lock_release ();
+  kmem_cache_free (&page_cache, p);
+}
@@ -0,0 +1,80 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "filesys/off_t.h"
+
+struct file;
+struct frame;
+struct thread;
+
+/* Where a virtual page's contents come from when it is not in
+   memory. */
+enum page_type
+  {
+    PAGE_FILE,          /* Read from a file, zero the rest. */
+    PAGE_ZERO,          /* All zeros. */
+    PAGE_ANON,          /* In memory or in swap only. */
+    PAGE_MMAP           /* Mapped file: read from and written back to it. */
+  };
+
+/* A virtual page in a user process's supplemental page table.
+
+   The hardware page table only says which pages are in memory.
+   The supplemental page table also says, for every page the
+   process may touch, how to bring it in when it isn't. */
+struct page
+  {
+    void *upage;                /* User virtual address. */
+    struct thread *owner;       /* Owning process. */
+    struct frame *frame;        /* Frame holding the page, or null. */
+    enum page_type type;        /* Source of contents. */
+    bool writable;              /* Writable by the process? */
+
+    /* For PAGE_FILE and PAGE_MMAP. */
+    struct file *file;          /* File to read. */
+    off_t ofs;                  /* Offset in FILE. */
+    uint32_t read_bytes;        /* Bytes to read; the rest are zeroed. */
+
+    /* For PAGE_ANON. */
+    size_t swap_slot;           /* Swap slot, or SWAP_ERROR. */
+
+    struct hash_elem elem;      /* Element in owner's `pages'. */
+    struct list_elem frame_elem; /* Element in frame's `pages'. */
+  };
+
+/* Maximum size of a user stack, in pages. */
+extern size_t page_stack_limit;
+
+void page_init (void);
+bool page_table_init (void);
+bool page_table_copy (struct thread *parent);
+void page_table_destroy (void);
+
+struct page *page_add_file (void *upage, struct file *, off_t ofs,
+                            uint32_t read_bytes, bool writable);
+struct page *page_add_zero (void *upage, bool writable);
+struct page *page_add_mmap (void *upage, struct file *, off_t ofs,
+                            uint32_t read_bytes);
+void page_remove (struct page *);
+struct page *page_lookup (const void *uaddr);
+bool page_is_stack (const void *uaddr);
+
+bool page_in (struct page *);
+bool page_fault_in (const void *uaddr);
+bool page_unshare (const void *uaddr);
+
+bool page_pin (const void *uaddr, bool write);
+void page_unpin (const void *uaddr);
+bool page_pin_range (const void *uaddr, size_t size, bool write);
+void page_unpin_range (const void *uaddr, size_t size);
+
+bool page_out (struct frame *);
+
+void page_print_stats (void);
+
+#endif /* vm/page.h */
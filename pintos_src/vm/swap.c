@@ -0,0 +1,132 @@
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "devices/block.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Swap space.
+
+   The swap device, the block device in the BLOCK_SWAP role, is
+   divided into page-sized slots of PAGE_SECTORS consecutive
+   sectors each.  A bitmap records which slots are in use.
+   Without a swap device there are no slots, so swap_out()
+   always fails.
+
+   Processes created by fork share the swap slots of their
+   parent's swapped-out pages, so each slot has a reference
+   count and is freed when the last page using it lets go. */
+
+/* Number of sectors per page. */
+#define PAGE_SECTORS (PGSIZE / BLOCK_SECTOR_SIZE)
+
+static struct block *swap_device;       /* Swap device, or null. */
+static struct bitmap *swap_map;         /* Slots in use. */
+static uint16_t *ref_cnts;              /* Pages using each slot. */
+static struct lock swap_lock;           /* Protects swap_map. */
+
+/* Statistics. */
+static long long out_cnt;       /* Pages written to swap. */
+static long long in_cnt;        /* Pages read from swap. */
+
+/* Sets up swap space on the swap device, if there is one. */
+void
+swap_init (void) 
+{
+  size_t slot_cnt = 0;
+
+  swap_device = block_get_role (BLOCK_SWAP);
+  if (swap_device != NULL)
+    slot_cnt = block_size (swap_device) / PAGE_SECTORS;
+  else
+    printf ("swap: no swap device, pages will not be swapped\n");
+  swap_map = bitmap_create (slot_cnt);
+  ref_cnts = calloc (slot_cnt, sizeof *ref_cnts);
+  if (swap_map == NULL || (ref_cnts == NULL && slot_cnt > 0))
+    PANIC ("swap: out of memory");
+  lock_init (&swap_lock);
+}
+
+/* Writes the page at KPAGE to a free swap slot and returns the
+   slot, or SWAP_ERROR if swap is full. */
+size_t
+swap_out (const void *kpage) 
+{
+  size_t slot;
+  size_t i;
+
+  lock_acquire (&swap_lock);
+  slot = bitmap_scan_and_flip_next (swap_map, 1, false);
+  if (slot != BITMAP_ERROR) 
+    {
+      ref_cnts[slot] = 1;
+      out_cnt++;
+    }
+  lock_release (&swap_lock);
+  if (slot == BITMAP_ERROR)
+    return SWAP_ERROR;
+
+  for (i = 0; i < PAGE_SECTORS; i++)
+    block_write (swap_device, slot * PAGE_SECTORS + i,
+                 (const uint8_t *) kpage + i * BLOCK_SECTOR_SIZE);
+  return slot;
+}
+
+/* Reads swap slot SLOT into the page at KPAGE and releases the
+   caller's reference to the slot. */
+void
+swap_in (size_t slot, void *kpage) 
+{
+  size_t i;
+
+  ASSERT (bitmap_test (swap_map, slot));
+
+  for (i = 0; i < PAGE_SECTORS; i++)
+    block_read (swap_device, slot * PAGE_SECTORS + i,
+                (uint8_t *) kpage + i * BLOCK_SECTOR_SIZE);
+
+  lock_acquire (&swap_lock);
+  in_cnt++;
+  lock_release (&swap_lock);
+  swap_free (slot);
+}
+
+/* Adds a reference to swap slot SLOT, for a page that shares it. */
+void
+swap_dup (size_t slot) 
+{
+  lock_acquire (&swap_lock);
+  ASSERT (bitmap_test (swap_map, slot));
+  ASSERT (ref_cnts[slot] < UINT16_MAX);
+  ref_cnts[slot]++;
+  lock_release (&swap_lock);
+}
+
+/* Releases a reference to swap slot SLOT without reading it,
+   freeing the slot if that was the last one. */
+void
+swap_free (size_t slot) 
+{
+  lock_acquire (&swap_lock);
+  ASSERT (bitmap_test (swap_map, slot));
+  if (--ref_cnts[slot] == 0)
+    bitmap_reset (swap_map, slot);
+  lock_release (&swap_lock);
+}
+
+/* Prints swap statistics. */
+void
+swap_print_stats (void) 
+{
+  size_t slot_cnt;
+
+  if (swap_map == NULL)
+    return;
+  slot_cnt = bitmap_size (swap_map);
+  printf ("Swap: %lld pages out, %lld pages in, %zu of %zu slots in use\n",
+          out_cnt, in_cnt, bitmap_count (swap_map, 0, slot_cnt, true),
+          slot_cnt);
+}